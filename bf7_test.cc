@@ -6,6 +6,7 @@
 #include "data.h"
 #include "log.h"
 #include "fs.h"
+#include "doubletime.h"
 
 int main(int argc, char **argv)
 {
@@ -74,6 +75,32 @@ int main(int argc, char **argv)
 	ss::data bf7cbchmacsha2256_dec = ss::data::decrypt_bf7_cbc_hmac_sha2_256(bf7cbchmacsha2256_enc, cbc_key, cbc_iv);
 	ctx.log(std::format("Full test: decrypted data is {} length {}", bf7cbchmacsha2256_dec.as_hex_str_nospace(), bf7cbchmacsha2256_dec.size()));
 	
+	// throughput: the static functions schedule the key on every call, a context schedules it once
+	ss::data::bf7_context bf7_ctx(cbc_key);
+	ss::data bulk;
+	bulk.random(4 * 1048576);
+	long double start = ss::doubletime::now_as_long_double();
+	ss::data bulk_enc = bf7_ctx.encrypt_cbc(bulk, cbc_iv);
+	long double enc_secs = ss::doubletime::now_as_long_double() - start;
+	start = ss::doubletime::now_as_long_double();
+	ss::data bulk_dec = bf7_ctx.decrypt_cbc(bulk_enc, cbc_iv);
+	long double dec_secs = ss::doubletime::now_as_long_double() - start;
+	ctx.log(std::format("bf7 context cbc 4MB: encrypt {:.1f} MB/s decrypt {:.1f} MB/s check {}", (double)(4.0L / enc_secs), (double)(4.0L / dec_secs), bulk_dec == bulk));
+	ss::data small;
+	small.random(1024);
+	const std::size_t small_reps = 1000;
+	ss::data small_expected = ss::data::encrypt_bf7_cbc_hmac_sha2_256(small, cbc_key, cbc_iv);
+	bool small_check = true;
+	start = ss::doubletime::now_as_long_double();
+	for (std::size_t i = 0; i < small_reps; ++i)
+		small_check &= (ss::data::encrypt_bf7_cbc_hmac_sha2_256(small, cbc_key, cbc_iv) == small_expected);
+	long double static_secs = ss::doubletime::now_as_long_double() - start;
+	start = ss::doubletime::now_as_long_double();
+	for (std::size_t i = 0; i < small_reps; ++i)
+		small_check &= (bf7_ctx.encrypt_cbc_hmac_sha2_256(small, cbc_iv) == small_expected);
+	long double ctx_secs = ss::doubletime::now_as_long_double() - start;
+	ctx.log(std::format("bf7 1KB messages: static {:.0f} msgs/sec context {:.0f} msgs/sec check {}", (double)(small_reps / static_secs), (double)(small_reps / ctx_secs), small_check));
+	
 	std::string l_lsmsg = "Please don't eat the Tide Pods. They are not good for you. Eat some nightshade berries instead, they are tasty and nutritious!";
 	ctx.log(std::format("LS mesg: {}", l_lsmsg));
 	std::string l_lsmsg_enc = ss::data::encode_little_secret("Stephen Sviatko", l_lsmsg);
@@ -91,6 +118,44 @@ int main(int argc, char **argv)
 	// with correct passphrase
 	std::string l_lsmsg2_dec2 = ss::data::decode_little_secret("Stephen Sviatko", l_lsmsg2_enc);
 	ctx.log(std::format("decoded: {}", l_lsmsg2_dec2));
-	
+
+	// startup style load: 200 secrets under a few passphrases, one call each with the key cache off, then
+	// one call each with it on, then one batch per passphrase
+	const std::array<std::string, 3> l_passphrases = { "Stephen Sviatko", "config service", "another passphrase" };
+	std::vector<std::string> l_secrets, l_encoded;
+	for (std::size_t i = 0; i < 200; ++i) {
+		l_secrets.push_back(std::format("secret number {}", i));
+		l_encoded.push_back(ss::data::encode_little_secret(l_passphrases[i % l_passphrases.size()], l_secrets.back()));
+	}
+	l_encoded[7] = "b" + l_encoded[7].substr(1); // an unsupported version and a damaged secret come back as errors, not exceptions
+	l_encoded[8][10] ^= 1;
+	ss::data::little_secret_cache_size(0);
+	start = ss::doubletime::now_as_long_double();
+	std::vector<std::string> l_uncached;
+	for (std::size_t i = 0; i < l_encoded.size(); ++i)
+		l_uncached.push_back(ss::data::decode_little_secret(l_passphrases[i % l_passphrases.size()], l_encoded[i]));
+	long double uncached_secs = ss::doubletime::now_as_long_double() - start;
+	ss::data::little_secret_cache_size(ss::data::LITTLE_SECRET_CACHE_ENTRIES);
+	start = ss::doubletime::now_as_long_double();
+	std::vector<std::string> l_cached;
+	for (std::size_t i = 0; i < l_encoded.size(); ++i)
+		l_cached.push_back(ss::data::decode_little_secret(l_passphrases[i % l_passphrases.size()], l_encoded[i]));
+	long double cached_secs = ss::doubletime::now_as_long_double() - start;
+	start = ss::doubletime::now_as_long_double();
+	std::vector<std::string> l_batched(l_encoded.size());
+	for (std::size_t p = 0; p < l_passphrases.size(); ++p) {
+		std::vector<std::string> l_mine;
+		for (std::size_t i = p; i < l_encoded.size(); i += l_passphrases.size())
+			l_mine.push_back(l_encoded[i]);
+		std::vector<std::string> l_decoded = ss::data::decode_little_secrets(l_passphrases[p], l_mine);
+		for (std::size_t i = p, j = 0; i < l_encoded.size(); i += l_passphrases.size(), ++j)
+			l_batched[i] = l_decoded[j];
+	}
+	long double batched_secs = ss::doubletime::now_as_long_double() - start;
+	bool ls_check = (l_cached == l_uncached) && (l_batched == l_uncached) && (l_uncached[0] == l_secrets[0]) && (l_uncached[199] == l_secrets[199]);
+	ls_check &= (l_uncached[7].substr(0, 6) == "error ") && (l_uncached[8].substr(0, 6) == "error ");
+	ctx.log(std::format("200 little secrets, 3 passphrases: uncached {:.0f} secrets/sec cached {:.0f} secrets/sec batched {:.0f} secrets/sec check {}",
+		(double)(200 / uncached_secs), (double)(200 / cached_secs), (double)(200 / batched_secs), ls_check));
+
 	return 0;
 }
\ No newline at end of file
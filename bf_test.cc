@@ -134,7 +134,17 @@ int main(int argc, char **argv)
 	ctx.log(std::format("CBC test: key is {} length {}", cbc_key.as_hex_str_nospace(), cbc_key.size()));
 	ctx.log(std::format("CBC test: iv is {} length {}", cbc_iv.as_hex_str_nospace(), cbc_iv.size()));
 	ctx.log(std::format("CBC test: decrypted data is {} length {}", enc_cbcdec.as_hex_str_nospace(), enc_cbcdec.size()));
-	
+
+	// in place and caller owned memory have to match the copying versions
+	ss::data cbc_in_place = cbc_data;
+	ss::data::bf_encrypt_with_cbc_in_place(cbc_in_place, cbc_key, cbc_iv);
+	bool in_place_check = (cbc_in_place == enc_cbcenc);
+	std::vector<std::uint8_t> cbc_span(enc_cbcenc.buffer(), enc_cbcenc.buffer() + enc_cbcenc.size());
+	ss::data::bf_decrypt_with_cbc(std::span<std::uint8_t>(cbc_span), cbc_key, cbc_iv);
+	ss::data::bf_decrypt_with_cbc_in_place(cbc_in_place, cbc_key, cbc_iv);
+	in_place_check &= (cbc_in_place == enc_cbcdec) && std::equal(cbc_span.begin(), cbc_span.end(), enc_cbcdec.buffer());
+	ctx.log(std::format("CBC test: in place and span check {}", in_place_check));
+
 	ss::data bfcbchmacsha2256_enc = ss::data::encrypt_bf_cbc_hmac_sha2_256(cbc_data, cbc_key, cbc_iv);
 	ctx.log(std::format("Full test: encrypted data is {} length {}", bfcbchmacsha2256_enc.as_hex_str_nospace(), bfcbchmacsha2256_enc.size()));
 	ss::data bfcbchmacsha2256_dec = ss::data::decrypt_bf_cbc_hmac_sha2_256(bfcbchmacsha2256_enc, cbc_key, cbc_iv);
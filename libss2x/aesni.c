@@ -0,0 +1,318 @@
+/*
+
+AES256 using the AES-NI instruction set. Key expansion follows the Intel AES-NI white paper
+(Gueron, "Intel Advanced Encryption Standard (AES) New Instructions Set"), and GHASH for GCM
+uses PCLMULQDQ as in the companion carry-less multiplication paper. The functions are compiled
+with target attributes, so the rest of the library doesn't need -maes and callers pick this
+or aes.c at run time with AESNI_available().
+
+*/
+
+#include <string.h>
+#include "aesni.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+
+int AESNI_available(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("aes") ? 1 : 0;
+}
+
+static AESNI_TARGET __m128i key_256_assist_1(__m128i temp1, __m128i temp2)
+{
+	__m128i temp4;
+	temp2 = _mm_shuffle_epi32(temp2, 0xff);
+	temp4 = _mm_slli_si128(temp1, 0x4);
+	temp1 = _mm_xor_si128(temp1, temp4);
+	temp4 = _mm_slli_si128(temp4, 0x4);
+	temp1 = _mm_xor_si128(temp1, temp4);
+	temp4 = _mm_slli_si128(temp4, 0x4);
+	temp1 = _mm_xor_si128(temp1, temp4);
+	return _mm_xor_si128(temp1, temp2);
+}
+
+static AESNI_TARGET __m128i key_256_assist_2(__m128i temp1, __m128i temp3)
+{
+	__m128i temp2, temp4;
+	temp4 = _mm_aeskeygenassist_si128(temp1, 0x0);
+	temp2 = _mm_shuffle_epi32(temp4, 0xaa);
+	temp4 = _mm_slli_si128(temp3, 0x4);
+	temp3 = _mm_xor_si128(temp3, temp4);
+	temp4 = _mm_slli_si128(temp4, 0x4);
+	temp3 = _mm_xor_si128(temp3, temp4);
+	temp4 = _mm_slli_si128(temp4, 0x4);
+	temp3 = _mm_xor_si128(temp3, temp4);
+	return _mm_xor_si128(temp3, temp2);
+}
+
+#define KEY_256_ROUND(i, rcon) \
+	temp1 = key_256_assist_1(temp1, _mm_aeskeygenassist_si128(temp3, rcon)); \
+	rk[i] = temp1; \
+	temp3 = key_256_assist_2(temp1, temp3); \
+	rk[i + 1] = temp3;
+
+AESNI_TARGET void AESNI_init_ctx(struct AESNI_ctx* ctx, const uint8_t* key)
+{
+	__m128i rk[15];
+	__m128i temp1, temp3;
+	int i;
+
+	temp1 = _mm_loadu_si128((const __m128i *)key);
+	temp3 = _mm_loadu_si128((const __m128i *)(key + 16));
+	rk[0] = temp1;
+	rk[1] = temp3;
+	KEY_256_ROUND(2, 0x01);
+	KEY_256_ROUND(4, 0x02);
+	KEY_256_ROUND(6, 0x04);
+	KEY_256_ROUND(8, 0x08);
+	KEY_256_ROUND(10, 0x10);
+	KEY_256_ROUND(12, 0x20);
+	// last round only needs the first half
+	rk[14] = key_256_assist_1(temp1, _mm_aeskeygenassist_si128(temp3, 0x40));
+
+	// the equivalent inverse cipher wants the middle round keys run through InvMixColumns
+	for (i = 0; i < 15; i++) {
+		_mm_storeu_si128((__m128i *)(ctx->EncKey + i * 16), rk[i]);
+		if ((i == 0) || (i == 14))
+			_mm_storeu_si128((__m128i *)(ctx->DecKey + i * 16), rk[14 - i]);
+		else
+			_mm_storeu_si128((__m128i *)(ctx->DecKey + i * 16), _mm_aesimc_si128(rk[14 - i]));
+	}
+}
+
+static AESNI_TARGET __m128i encrypt_one(const struct AESNI_ctx* ctx, __m128i x)
+{
+	const __m128i *rk = (const __m128i *)ctx->EncKey;
+	int i;
+	x = _mm_xor_si128(x, _mm_loadu_si128(rk));
+	for (i = 1; i < 14; i++)
+		x = _mm_aesenc_si128(x, _mm_loadu_si128(rk + i));
+	return _mm_aesenclast_si128(x, _mm_loadu_si128(rk + 14));
+}
+
+static AESNI_TARGET __m128i decrypt_one(const struct AESNI_ctx* ctx, __m128i x)
+{
+	const __m128i *rk = (const __m128i *)ctx->DecKey;
+	int i;
+	x = _mm_xor_si128(x, _mm_loadu_si128(rk));
+	for (i = 1; i < 14; i++)
+		x = _mm_aesdec_si128(x, _mm_loadu_si128(rk + i));
+	return _mm_aesdeclast_si128(x, _mm_loadu_si128(rk + 14));
+}
+
+AESNI_TARGET void AESNI_ECB_encrypt(const struct AESNI_ctx* ctx, uint8_t* buf)
+{
+	_mm_storeu_si128((__m128i *)buf, encrypt_one(ctx, _mm_loadu_si128((const __m128i *)buf)));
+}
+
+AESNI_TARGET void AESNI_ECB_decrypt(const struct AESNI_ctx* ctx, uint8_t* buf)
+{
+	_mm_storeu_si128((__m128i *)buf, decrypt_one(ctx, _mm_loadu_si128((const __m128i *)buf)));
+}
+
+AESNI_TARGET void AESNI_CBC_encrypt(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* iv)
+{
+	// each block depends on the one before, so this can only go as fast as one block's latency
+	__m128i l_iv = _mm_loadu_si128((const __m128i *)iv);
+	size_t pos;
+	for (pos = 0; pos < length; pos += 16) {
+		l_iv = encrypt_one(ctx, _mm_xor_si128(l_iv, _mm_loadu_si128((const __m128i *)(buf + pos))));
+		_mm_storeu_si128((__m128i *)(buf + pos), l_iv);
+	}
+}
+
+AESNI_TARGET void AESNI_CBC_decrypt(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* iv)
+{
+	// blocks decrypt independently, so keep four in flight to cover the aesdec latency
+	const __m128i *rk = (const __m128i *)ctx->DecKey;
+	__m128i l_iv = _mm_loadu_si128((const __m128i *)iv);
+	size_t pos = 0;
+	int i;
+	for (; pos + 64 <= length; pos += 64) {
+		__m128i c0 = _mm_loadu_si128((const __m128i *)(buf + pos));
+		__m128i c1 = _mm_loadu_si128((const __m128i *)(buf + pos + 16));
+		__m128i c2 = _mm_loadu_si128((const __m128i *)(buf + pos + 32));
+		__m128i c3 = _mm_loadu_si128((const __m128i *)(buf + pos + 48));
+		__m128i k = _mm_loadu_si128(rk);
+		__m128i x0 = _mm_xor_si128(c0, k);
+		__m128i x1 = _mm_xor_si128(c1, k);
+		__m128i x2 = _mm_xor_si128(c2, k);
+		__m128i x3 = _mm_xor_si128(c3, k);
+		for (i = 1; i < 14; i++) {
+			k = _mm_loadu_si128(rk + i);
+			x0 = _mm_aesdec_si128(x0, k);
+			x1 = _mm_aesdec_si128(x1, k);
+			x2 = _mm_aesdec_si128(x2, k);
+			x3 = _mm_aesdec_si128(x3, k);
+		}
+		k = _mm_loadu_si128(rk + 14);
+		x0 = _mm_aesdeclast_si128(x0, k);
+		x1 = _mm_aesdeclast_si128(x1, k);
+		x2 = _mm_aesdeclast_si128(x2, k);
+		x3 = _mm_aesdeclast_si128(x3, k);
+		_mm_storeu_si128((__m128i *)(buf + pos), _mm_xor_si128(x0, l_iv));
+		_mm_storeu_si128((__m128i *)(buf + pos + 16), _mm_xor_si128(x1, c0));
+		_mm_storeu_si128((__m128i *)(buf + pos + 32), _mm_xor_si128(x2, c1));
+		_mm_storeu_si128((__m128i *)(buf + pos + 48), _mm_xor_si128(x3, c2));
+		l_iv = c3;
+	}
+	for (; pos < length; pos += 16) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(buf + pos));
+		_mm_storeu_si128((__m128i *)(buf + pos), _mm_xor_si128(decrypt_one(ctx, c), l_iv));
+		l_iv = c;
+	}
+}
+
+AESNI_TARGET void AESNI_CTR_xor(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* ctr)
+{
+	// eight counter blocks per pass; they're independent, so the aesenc latency overlaps
+	const __m128i *rk = (const __m128i *)ctx->EncKey;
+	uint64_t hi, lo;
+	memcpy(&hi, ctr, 8);
+	memcpy(&lo, ctr + 8, 8);
+	hi = __builtin_bswap64(hi);
+	lo = __builtin_bswap64(lo);
+	__m128i x[8];
+	size_t pos = 0;
+	int i, j;
+
+#define CTR_NEXT(v) \
+	v = _mm_set_epi64x(__builtin_bswap64(lo), __builtin_bswap64(hi)); \
+	if (++lo == 0) \
+		++hi;
+
+	for (; pos + 128 <= length; pos += 128) {
+		__m128i k = _mm_loadu_si128(rk);
+		for (j = 0; j < 8; j++) {
+			CTR_NEXT(x[j]);
+			x[j] = _mm_xor_si128(x[j], k);
+		}
+		for (i = 1; i < 14; i++) {
+			k = _mm_loadu_si128(rk + i);
+			for (j = 0; j < 8; j++)
+				x[j] = _mm_aesenc_si128(x[j], k);
+		}
+		k = _mm_loadu_si128(rk + 14);
+		for (j = 0; j < 8; j++) {
+			x[j] = _mm_aesenclast_si128(x[j], k);
+			_mm_storeu_si128((__m128i *)(buf + pos + j * 16), _mm_xor_si128(x[j], _mm_loadu_si128((const __m128i *)(buf + pos + j * 16))));
+		}
+	}
+	for (; pos < length; pos += 16) {
+		uint8_t ks[16];
+		size_t n = (length - pos < 16) ? length - pos : 16;
+		CTR_NEXT(x[0]);
+		_mm_storeu_si128((__m128i *)ks, encrypt_one(ctx, x[0]));
+		for (j = 0; j < (int)n; j++)
+			buf[pos + j] ^= ks[j];
+	}
+#undef CTR_NEXT
+}
+
+#define GHASH_TARGET __attribute__((target("pclmul,sse2,ssse3")))
+
+int AESNI_GHASH_available(void)
+{
+	__builtin_cpu_init();
+	return (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3")) ? 1 : 0;
+}
+
+// carry-less multiply and reduce, on byte reflected operands (Intel's gfmul, white paper algorithm 5)
+static GHASH_TARGET __m128i gfmul(__m128i a, __m128i b)
+{
+	__m128i tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, tmp9;
+	tmp3 = _mm_clmulepi64_si128(a, b, 0x00);
+	tmp4 = _mm_clmulepi64_si128(a, b, 0x10);
+	tmp5 = _mm_clmulepi64_si128(a, b, 0x01);
+	tmp6 = _mm_clmulepi64_si128(a, b, 0x11);
+	tmp4 = _mm_xor_si128(tmp4, tmp5);
+	tmp5 = _mm_slli_si128(tmp4, 8);
+	tmp4 = _mm_srli_si128(tmp4, 8);
+	tmp3 = _mm_xor_si128(tmp3, tmp5);
+	tmp6 = _mm_xor_si128(tmp6, tmp4);
+	// shift the 256 bit product left by one
+	tmp7 = _mm_srli_epi32(tmp3, 31);
+	tmp8 = _mm_srli_epi32(tmp6, 31);
+	tmp3 = _mm_slli_epi32(tmp3, 1);
+	tmp6 = _mm_slli_epi32(tmp6, 1);
+	tmp9 = _mm_srli_si128(tmp7, 12);
+	tmp8 = _mm_slli_si128(tmp8, 4);
+	tmp7 = _mm_slli_si128(tmp7, 4);
+	tmp3 = _mm_or_si128(tmp3, tmp7);
+	tmp6 = _mm_or_si128(tmp6, tmp8);
+	tmp6 = _mm_or_si128(tmp6, tmp9);
+	// reduce modulo x^128 + x^7 + x^2 + x + 1
+	tmp7 = _mm_slli_epi32(tmp3, 31);
+	tmp8 = _mm_slli_epi32(tmp3, 30);
+	tmp9 = _mm_slli_epi32(tmp3, 25);
+	tmp7 = _mm_xor_si128(tmp7, tmp8);
+	tmp7 = _mm_xor_si128(tmp7, tmp9);
+	tmp8 = _mm_srli_si128(tmp7, 4);
+	tmp7 = _mm_slli_si128(tmp7, 12);
+	tmp3 = _mm_xor_si128(tmp3, tmp7);
+	tmp2 = _mm_srli_epi32(tmp3, 1);
+	tmp4 = _mm_srli_epi32(tmp3, 2);
+	tmp5 = _mm_srli_epi32(tmp3, 7);
+	tmp2 = _mm_xor_si128(tmp2, tmp4);
+	tmp2 = _mm_xor_si128(tmp2, tmp5);
+	tmp2 = _mm_xor_si128(tmp2, tmp8);
+	tmp3 = _mm_xor_si128(tmp3, tmp2);
+	return _mm_xor_si128(tmp6, tmp3);
+}
+
+GHASH_TARGET void AESNI_GHASH(const uint8_t* h, uint8_t* y, const uint8_t* buf, size_t length)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i h1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)h), bswap);
+	__m128i h2 = gfmul(h1, h1);
+	__m128i h3 = gfmul(h2, h1);
+	__m128i h4 = gfmul(h3, h1);
+	__m128i t = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)y), bswap);
+	size_t pos = 0;
+
+	// four blocks at a time: Y = (Y ^ X1)H^4 ^ X2 H^3 ^ X3 H^2 ^ X4 H, four independent multiplies
+	for (; pos + 64 <= length; pos += 64) {
+		__m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + pos)), bswap);
+		__m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + pos + 16)), bswap);
+		__m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + pos + 32)), bswap);
+		__m128i x4 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + pos + 48)), bswap);
+		t = _mm_xor_si128(_mm_xor_si128(gfmul(_mm_xor_si128(t, x1), h4), gfmul(x2, h3)), _mm_xor_si128(gfmul(x3, h2), gfmul(x4, h1)));
+	}
+	for (; pos < length; pos += 16)
+		t = gfmul(_mm_xor_si128(t, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + pos)), bswap)), h1);
+	_mm_storeu_si128((__m128i *)y, _mm_shuffle_epi8(t, bswap));
+}
+
+#else
+
+int AESNI_available(void)
+{
+	return 0;
+}
+
+void AESNI_init_ctx(struct AESNI_ctx* ctx, const uint8_t* key)
+{
+	memset(ctx, 0, sizeof(struct AESNI_ctx));
+}
+
+void AESNI_ECB_encrypt(const struct AESNI_ctx* ctx, uint8_t* buf) { }
+void AESNI_ECB_decrypt(const struct AESNI_ctx* ctx, uint8_t* buf) { }
+void AESNI_CBC_encrypt(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* iv) { }
+void AESNI_CBC_decrypt(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* iv) { }
+void AESNI_CTR_xor(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* ctr) { }
+
+int AESNI_GHASH_available(void)
+{
+	return 0;
+}
+
+void AESNI_GHASH(const uint8_t* h, uint8_t* y, const uint8_t* buf, size_t length) { }
+
+#endif
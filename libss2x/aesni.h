@@ -0,0 +1,38 @@
+#ifndef AESNI_H
+#define AESNI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+// AES256 through the AES-NI instructions. Check AESNI_available() before calling anything else;
+// on other architectures it always returns 0 and the remaining functions do nothing.
+
+struct AESNI_ctx
+{
+  uint8_t EncKey[15 * 16]; // round keys, same layout as AES_ctx.RoundKey
+  uint8_t DecKey[15 * 16]; // round keys for aesdec, in the order they're used
+};
+
+int AESNI_available(void);
+void AESNI_init_ctx(struct AESNI_ctx* ctx, const uint8_t* key);
+void AESNI_ECB_encrypt(const struct AESNI_ctx* ctx, uint8_t* buf);
+void AESNI_ECB_decrypt(const struct AESNI_ctx* ctx, uint8_t* buf);
+// length is a multiple of 16, buf is processed in place
+void AESNI_CBC_encrypt(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* iv);
+void AESNI_CBC_decrypt(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* iv);
+// xor the CTR keystream starting at counter block ctr (a 128 bit big endian counter) into buf, any length
+void AESNI_CTR_xor(const struct AESNI_ctx* ctx, uint8_t* buf, size_t length, const uint8_t* ctr);
+// GCM's GHASH through PCLMULQDQ: fold length bytes (a multiple of 16) into the 16 byte state y under hash key h.
+// Check AESNI_GHASH_available() first.
+int AESNI_GHASH_available(void);
+void AESNI_GHASH(const uint8_t* h, uint8_t* y, const uint8_t* buf, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AESNI_H */
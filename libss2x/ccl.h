@@ -84,6 +84,9 @@ template <typename T>
 void work_queue<T>::shut_down()
 {
 	m_shut_down = true;
+	// wake anything waiting for an item so it sees the shut down now rather than when its wait times out
+	std::lock_guard<std::mutex> l_guard(m_cond_mutex);
+	m_cond.notify_all();
 }
 
 template <typename T>
@@ -95,8 +98,12 @@ bool work_queue<T>::is_shut_down()
 template <typename T>
 void work_queue<T>::add_work_item(T a_item)
 {
-	std::lock_guard<std::mutex> l_guard(m_queue_mutex);
-	m_queue.push_back(a_item);
+	{
+		std::lock_guard<std::mutex> l_guard(m_queue_mutex);
+		m_queue.push_back(a_item);
+	}
+	// notify under m_cond_mutex: wait_for_item checks the queue holding it, so the wakeup can't be missed
+	std::lock_guard<std::mutex> l_guard(m_cond_mutex);
 	m_cond.notify_one();
 }
 
@@ -111,22 +118,21 @@ template <typename T>
 std::optional<T> work_queue<T>::wait_for_item(std::size_t a_ms)
 {
 	T ret;
-	m_queue_mutex.lock();
-	if (m_queue.size() == 0) {
-		m_queue_mutex.unlock();
-		// block on condition until we are signalled
+	{
+		// block on condition until there's an item or we're shut down
 		std::unique_lock l_ul(m_cond_mutex);
+		auto l_ready = [this]() {
+			std::lock_guard<std::mutex> l_guard(m_queue_mutex);
+			return (m_queue.size() > 0) || m_shut_down;
+		};
 		if (a_ms == 0) {
-			m_cond.wait(l_ul);
+			m_cond.wait(l_ul, l_ready);
 		} else {
-			if (m_cond.wait_for(l_ul, std::chrono::milliseconds(a_ms)) == std::cv_status::timeout) {
-				l_ul.unlock();
+			if (!m_cond.wait_for(l_ul, std::chrono::milliseconds(a_ms), l_ready))
 				return std::nullopt;
-			}
 		}
-		l_ul.unlock();
-		m_queue_mutex.lock(); // lock again when we wake up
 	}
+	m_queue_mutex.lock();
 	// queue contains items, or we woke up
 	// check to make sure queue actually has an item
 	if (m_queue.size() == 0) {
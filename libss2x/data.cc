@@ -1,4 +1,9 @@
 #include "data.h"
+#include "ccl.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
 
 namespace ss {
 
@@ -27,18 +32,235 @@ void data::bit_cursor::set_absolute(std::uint64_t a_absolute)
 	bit = 7 - (a_absolute & 0x7);
 }
 
-std::uint64_t data::bit_cursor::get_absolute()
+std::uint64_t data::bit_cursor::get_absolute() const
 {
 	std::uint64_t l_ret = byte << 3;
 	l_ret |= (7 - bit);
 	return l_ret;
 }
 
+/* bit writer */
+
+data::bit_writer::bit_writer(data& a_data)
+: m_data(a_data)
+, m_accum(0)
+, m_count(7 - a_data.m_write_bit_cursor.bit)
+, m_byte(a_data.m_write_bit_cursor.byte)
+{
+	a_data.no_circular_mode("bit_writer");
+	// this should never happen, set_write_bit_cursor protects against it
+	if (m_byte > m_data.m_buffer.size()) {
+		data_exception e("bit_writer: bit cursor set to impossible value.");
+		throw (e);
+	}
+
+	// if we're starting in the middle of a byte, pick up the bits that precede the cursor
+	// so they go back out untouched when the byte is committed
+	if ((m_count > 0) && (m_byte < m_data.m_buffer.size())) {
+		m_accum = static_cast<std::uint64_t>(m_data.m_buffer[m_byte]) << 56;
+		m_accum &= ~(0xffffffffffffffffULL >> m_count);
+	}
+}
+
+data::bit_writer::~bit_writer()
+{
+	flush();
+}
+
+void data::bit_writer::write_bits(std::uint64_t a_bits, std::uint16_t a_count)
+{
+	if (a_count > 64) {
+		data_exception e("write_bits: Bit count must between 0-64.");
+		throw (e);
+	}
+	if (a_count == 0)
+		return;
+
+	// the accumulator may already hold up to 7 bits, so wide fields go in as two halves
+	if (a_count > 56) {
+		write_bits(a_bits >> 32, a_count - 32);
+		a_bits &= 0xffffffffULL;
+		a_count = 32;
+	}
+
+	// left justify the field, which also shears off anything above a_count, then slide it in
+	// behind the pending bits
+	m_accum |= (a_bits << (64 - a_count)) >> m_count;
+	m_count += a_count;
+	if (m_count >= 8)
+		drain();
+}
+
+void data::bit_writer::drain()
+{
+	// commit every whole byte in the accumulator in one go
+	std::uint16_t l_bytes = m_count >> 3;
+	std::uint64_t l_out = m_accum;
+	if (std::endian::native == std::endian::little)
+		l_out = std::byteswap(l_out);
+	if (m_byte + l_bytes > m_data.m_buffer.size())
+		m_data.m_buffer.resize(m_byte + l_bytes);
+	memcpy(m_data.m_buffer.data() + m_byte, &l_out, l_bytes);
+	m_byte += l_bytes;
+	m_count -= (l_bytes << 3);
+	m_accum = (l_bytes == 8) ? 0 : (m_accum << (l_bytes << 3));
+}
+
+void data::bit_writer::flush()
+{
+	// merge the partial byte with whatever follows it in the buffer
+	if (m_count > 0) {
+		std::uint8_t l_mask = ~(0xff >> m_count);
+		if (m_byte == m_data.m_buffer.size())
+			m_data.m_buffer.push_back(0x00);
+		m_data.m_buffer[m_byte] &= ~l_mask;
+		m_data.m_buffer[m_byte] |= (static_cast<std::uint8_t>(m_accum >> 56) & l_mask);
+	}
+	m_data.m_write_bit_cursor = get_bit_cursor();
+}
+
+void data::bit_writer::advance_to_next_whole_byte()
+{
+	if (m_count > 0) {
+		flush();
+		++m_byte;
+		m_accum = 0;
+		m_count = 0;
+	}
+}
+
+data::bit_cursor data::bit_writer::get_bit_cursor() const
+{
+	bit_cursor l_ret;
+	l_ret.set_absolute((m_byte << 3) + m_count);
+	return l_ret;
+}
+
+/* bit reader */
+
+data::bit_reader::bit_reader(const data& a_data, bit_cursor a_start)
+: bit_reader(a_data.contents(), a_start)
+{
+}
+
+data::bit_reader::bit_reader(std::span<const std::uint8_t> a_buffer, bit_cursor a_start)
+: m_buffer(a_buffer.data())
+, m_size(a_buffer.size())
+, m_accum(0)
+, m_count(0)
+, m_byte(a_start.byte)
+{
+	if (a_start.bit < 7)
+		skip_bits(7 - a_start.bit);
+}
+
+void data::bit_reader::refill()
+{
+	const std::uint64_t l_size = m_size;
+	if (m_byte + 8 <= l_size) {
+		// fast path: one unaligned big endian load, take as many whole bytes as fit
+		std::uint16_t l_bytes = (64 - m_count) >> 3;
+		if (l_bytes == 0)
+			return;
+		std::uint64_t l_word;
+		memcpy(&l_word, m_buffer + m_byte, 8);
+		if (std::endian::native == std::endian::little)
+			l_word = std::byteswap(l_word);
+		m_accum |= (l_word >> m_count);
+		m_count += (l_bytes << 3);
+		m_byte += l_bytes;
+		// drop the partial byte we didn't claim
+		if (m_count < 64)
+			m_accum &= ~(0xffffffffffffffffULL >> m_count);
+	} else {
+		// near the end of the buffer, go a byte at a time
+		while ((m_count <= 56) && (m_byte < l_size)) {
+			m_accum |= static_cast<std::uint64_t>(m_buffer[m_byte++]) << (56 - m_count);
+			m_count += 8;
+		}
+	}
+}
+
+std::uint64_t data::bit_reader::read_bits(std::uint16_t a_count)
+{
+	if (a_count > 64) {
+		data_exception e("ss::data::read_bits: Bit count must between 0-64.");
+		throw (e);
+	}
+	if (a_count == 0)
+		return 0;
+
+	// a refill is only guaranteed to leave 57 bits in the accumulator, so split wide fields
+	if (a_count > 56) {
+		std::uint64_t l_hi = read_bits(a_count - 32);
+		return (l_hi << 32) | read_bits(32);
+	}
+
+	if (m_count < a_count) {
+		refill();
+		if (m_count < a_count) {
+			data_exception e("read_bit: Attempt cursor-mode read past end of buffer.");
+			throw (e);
+		}
+	}
+	std::uint64_t l_ret = m_accum >> (64 - a_count);
+	m_accum <<= a_count;
+	m_count -= a_count;
+	return l_ret;
+}
+
+std::uint64_t data::bit_reader::peek_bits(std::uint16_t a_count)
+{
+	if (a_count > 56) {
+		data_exception e("bit_reader::peek_bits: Bit count must be between 0-56.");
+		throw (e);
+	}
+	if (a_count == 0)
+		return 0;
+	if (m_count < a_count)
+		refill();
+	return (m_accum >> (64 - a_count));
+}
+
+void data::bit_reader::skip_bits(std::uint16_t a_count)
+{
+	if (a_count > 56) {
+		data_exception e("bit_reader::skip_bits: Bit count must be between 0-56.");
+		throw (e);
+	}
+	if (m_count < a_count) {
+		refill();
+		if (m_count < a_count) {
+			data_exception e("read_bit: Attempt cursor-mode read past end of buffer.");
+			throw (e);
+		}
+	}
+	m_accum <<= a_count;
+	m_count -= a_count;
+}
+
+void data::bit_reader::advance_to_next_whole_byte()
+{
+	// m_byte is always byte aligned, so whatever is left over past a multiple of 8 belongs to the current byte
+	std::uint16_t l_drop = m_count & 0x7;
+	m_accum <<= l_drop;
+	m_count -= l_drop;
+}
+
+data::bit_cursor data::bit_reader::get_bit_cursor() const
+{
+	bit_cursor l_ret;
+	l_ret.set_absolute((m_byte << 3) - m_count);
+	return l_ret;
+}
+
 /* data */
 
 data::data()
 : m_network_byte_order(false)
 , m_circular_mode(false)
+, m_ring_head(0)
+, m_ring_size(0)
 , m_read_cursor(0)
 , m_write_cursor(0)
 , m_delimiter(0xa)
@@ -55,17 +277,17 @@ data::data(const data& a_data)
 	copy_construct(a_data);
 }
 
-data::data(data&& a_data)
+data::data(data&& a_data) noexcept
 {
-	copy_construct(a_data);
-//	// clear foreign data object after we move it
-//	a_data.clear();
+	move_construct(a_data);
 }
 
 void data::copy_construct(const data& a_data)
 {
 	m_network_byte_order = a_data.m_network_byte_order;
 	m_circular_mode = a_data.m_circular_mode;
+	m_ring_head = a_data.m_ring_head;
+	m_ring_size = a_data.m_ring_size;
 	m_read_cursor = a_data.m_read_cursor;
 	m_write_cursor = a_data.m_write_cursor;
 	m_delimiter = a_data.m_delimiter;
@@ -75,6 +297,22 @@ void data::copy_construct(const data& a_data)
 	m_buffer = a_data.m_buffer;
 }
 
+void data::move_construct(data& a_data)
+{
+	m_network_byte_order = a_data.m_network_byte_order;
+	m_circular_mode = a_data.m_circular_mode;
+	m_ring_head = a_data.m_ring_head;
+	m_ring_size = a_data.m_ring_size;
+	m_read_cursor = a_data.m_read_cursor;
+	m_write_cursor = a_data.m_write_cursor;
+	m_delimiter = a_data.m_delimiter;
+	m_huffman_debug = a_data.m_huffman_debug;
+	m_read_bit_cursor = a_data.m_read_bit_cursor;
+	m_write_bit_cursor = a_data.m_write_bit_cursor;
+	m_buffer = std::move(a_data.m_buffer);
+	a_data.clear();
+}
+
 void data::dump_hex() const
 {
 	std::cout << as_hex_str() << std::endl;
@@ -83,7 +321,7 @@ void data::dump_hex() const
 std::string data::as_hex_str() const
 {
 	std::stringstream l_ss;
-	for (const auto i : m_buffer) {
+	for (const auto i : contents()) {
 		l_ss << std::hex << std::setfill('0') << std::setw(2) << (int)i << " ";
 	}
 	return l_ss.str();
@@ -92,7 +330,7 @@ std::string data::as_hex_str() const
 std::string data::as_hex_str_nospace() const
 {
 	std::stringstream l_ss;
-	for (const auto i : m_buffer) {
+	for (const auto i : contents()) {
 		l_ss << std::hex << std::setfill('0') << std::setw(2) << (int)i;
 	}
 	return l_ss.str();
@@ -107,7 +345,7 @@ void data::save_file(const std::string& a_filename)
 		throw(e);
 	}
 
-	l_savefile.write((char *)m_buffer.data(), m_buffer.size());
+	l_savefile.write((char *)contents().data(), size());
 	if (!l_savefile.good()) {
 		data_exception e("unable to write to file.");
 		throw(e);
@@ -124,24 +362,134 @@ void data::load_file(const std::string& a_filename)
 		data_exception e("unable to open file to load data.");
 		throw(e);
 	}
+	// some files (/proc, pipes, FIFOs) don't know their size or can't seek; those get read a chunk at a time below
+	std::streamoff l_size = -1;
+	l_loadfile.seekg(0, std::ios::end);
+	if (!l_loadfile.fail()) {
+		l_size = l_loadfile.tellg();
+		l_loadfile.seekg(0);
+		if (l_loadfile.fail())
+			l_size = -1;
+	}
+	l_loadfile.clear();
+
+	// one read of the size the file claims to be, straight into the buffer when appending to the end of it
+	if (l_size > 0) {
+		if (!m_circular_mode && (m_write_cursor == m_buffer.size())) {
+			m_buffer.resize(m_write_cursor + l_size);
+			l_loadfile.read((char *)m_buffer.data() + m_write_cursor, l_size);
+			m_buffer.resize(m_write_cursor + l_loadfile.gcount());
+			m_write_cursor += l_loadfile.gcount();
+		} else {
+			std::vector<std::uint8_t> l_work(l_size);
+			l_loadfile.read((char *)l_work.data(), l_size);
+			write_bytes(l_work.data(), l_loadfile.gcount());
+		}
+		if (l_loadfile.bad()) {
+			data_exception e("unable to read file.");
+			throw(e);
+		}
+	}
 
+	// then whatever is left, for files that don't know their size or grew meanwhile. A short read sets
+	// failbit as well as eofbit, so stop on either.
 	std::array<char, 4096> l_buff;
-
-	do {
-		l_loadfile.read(l_buff.data(), 4096);
+	while (!l_loadfile.fail()) {
+		l_loadfile.read(l_buff.data(), l_buff.size());
 		if (l_loadfile.bad()) {
 			data_exception e("unable to read file.");
 			throw(e);
 		}
-		std::uint64_t l_bytes_read = l_loadfile.gcount();
-		std::vector<std::uint8_t> l_pass;
-		l_pass.assign(l_buff.data(), l_buff.data() + l_bytes_read);
-		write_raw_data(l_pass);
-	} while (!l_loadfile.eof());
+		write_bytes(l_buff.data(), l_loadfile.gcount());
+	}
 
 	l_loadfile.close();
 }
 
+/* mapped files */
+
+data::mapped_file::mapped_file(const std::string& a_filename, map_mode a_mode, std::size_t a_size)
+: m_map(nullptr)
+, m_size(0)
+, m_mode(a_mode)
+{
+	int l_fd = (a_mode == MAP_READ_WRITE) ? open(a_filename.c_str(), O_RDWR | O_CREAT, 0644) : open(a_filename.c_str(), O_RDONLY);
+	if (l_fd < 0) {
+		data_exception e("mapped_file: unable to open file.");
+		throw(e);
+	}
+	if ((a_mode == MAP_READ_WRITE) && (a_size > 0) && (ftruncate(l_fd, a_size) != 0)) {
+		close(l_fd);
+		data_exception e("mapped_file: unable to size file.");
+		throw(e);
+	}
+	struct stat l_stat;
+	if (fstat(l_fd, &l_stat) != 0) {
+		close(l_fd);
+		data_exception e("mapped_file: unable to stat file.");
+		throw(e);
+	}
+	m_size = l_stat.st_size;
+	// an empty file can't be mapped, but it doesn't need to be
+	if (m_size > 0) {
+		void *l_map = (a_mode == MAP_READ_WRITE) ? mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, l_fd, 0)
+			: mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, l_fd, 0);
+		if (l_map == MAP_FAILED) {
+			close(l_fd);
+			data_exception e("mapped_file: unable to map file.");
+			throw(e);
+		}
+		m_map = (std::uint8_t *)l_map;
+		madvise(m_map, m_size, MADV_SEQUENTIAL);
+	}
+	close(l_fd); // the mapping holds its own reference to the file
+}
+
+data::mapped_file::mapped_file(mapped_file&& a_mapped_file)
+: m_map(a_mapped_file.m_map)
+, m_size(a_mapped_file.m_size)
+, m_mode(a_mapped_file.m_mode)
+{
+	a_mapped_file.m_map = nullptr;
+	a_mapped_file.m_size = 0;
+}
+
+data::mapped_file::~mapped_file()
+{
+	if (m_map)
+		munmap(m_map, m_size);
+}
+
+std::span<std::uint8_t> data::mapped_file::writable()
+{
+	if (m_mode != MAP_READ_WRITE) {
+		data_exception e("mapped_file: file is mapped read only.");
+		throw(e);
+	}
+	return std::span<std::uint8_t>(m_map, m_size);
+}
+
+data_view data::mapped_file::view() const
+{
+	return data_view(m_map, m_size);
+}
+
+data data::mapped_file::to_data() const
+{
+	data l_ret;
+	if (m_size > 0)
+		l_ret.write_bytes(m_map, m_size);
+	return l_ret;
+}
+
+void data::mapped_file::sync()
+{
+	if (m_map && (m_mode == MAP_READ_WRITE) && (msync(m_map, m_size, MS_SYNC) != 0)) {
+		data_exception e("mapped_file: unable to sync file.");
+		throw(e);
+	}
+}
+
 void data::write_std_str(const std::string& a_str)
 {
 	std::vector<std::uint8_t> l_pass;
@@ -164,9 +512,26 @@ void data::write_std_str_delim(const std::string& a_str)
 
 std::optional<std::string> data::read_std_str_delim()
 {
+	if (m_circular_mode) {
+		if (m_ring_size == 0)
+			return std::nullopt;
+		// look in the run up to the wrap, then in the run from the start of the ring
+		std::span<const std::uint8_t> l_first = circular_readable();
+		const std::uint8_t *l_delim = (const std::uint8_t *)memchr(l_first.data(), m_delimiter, l_first.size());
+		std::size_t l_len = l_delim ? l_delim - l_first.data() : 0;
+		if (!l_delim && (l_first.size() < m_ring_size)) {
+			l_delim = (const std::uint8_t *)memchr(m_buffer.data(), m_delimiter, m_ring_size - l_first.size());
+			l_len = l_delim ? l_first.size() + (l_delim - m_buffer.data()) : 0;
+		}
+		if (!l_delim)
+			return std::nullopt;
+		std::string l_ret(l_len, '\0');
+		ring_read((std::uint8_t *)l_ret.data(), l_len);
+		ring_consume(1);
+		return l_ret;
+	}
 	std::vector<std::uint8_t>::iterator l_begin = m_buffer.begin();
-	if (!m_circular_mode)
-		std::advance(l_begin, m_read_cursor);
+	std::advance(l_begin, m_read_cursor);
 	auto l_delim_pos = std::find(l_begin, m_buffer.end(), m_delimiter);
 	if (l_delim_pos == m_buffer.end()) {
 		return std::nullopt;
@@ -174,10 +539,7 @@ std::optional<std::string> data::read_std_str_delim()
 		std::vector<std::uint8_t> l_work;
 		std::copy(l_begin, l_delim_pos, std::back_inserter(l_work));
 		std::string l_ret((char *)(l_work.data()), l_work.size());
-		if (m_circular_mode)
-			truncate_front(l_work.size() + 1);
-		else
-			m_read_cursor += l_work.size() + 1;
+		m_read_cursor += l_work.size() + 1;
 		return l_ret;
 	}
 }
@@ -186,15 +548,8 @@ std::vector<std::uint8_t> data::read_raw_data(std::size_t a_num_bytes)
 {
 	std::vector<std::uint8_t> l_ret;
 	if (m_circular_mode) {
-		// if number of bytes requested exceeds buffer size, error
-		if (a_num_bytes > m_buffer.size()) {
-			data_exception e("attempt circular mode read larger than buffer size.");
-			throw (e);
-		}
-		std::vector<std::uint8_t>::iterator l_final = m_buffer.begin();
-		std::advance(l_final, a_num_bytes);
-		std::copy(m_buffer.begin(), l_final, std::back_inserter(l_ret));
-		truncate_front(a_num_bytes);
+		l_ret.resize(a_num_bytes);
+		ring_read(l_ret.data(), a_num_bytes);
 	} else {
 		// normal mode read
 		if (m_read_cursor + a_num_bytes > m_buffer.size()) {
@@ -213,27 +568,24 @@ std::vector<std::uint8_t> data::read_raw_data(std::size_t a_num_bytes)
 
 void data::write_raw_data(const std::vector<std::uint8_t>& a_vector)
 {
-	if (m_circular_mode)
-		set_write_cursor_to_append();
-	// add space to vector if we're overwriting the end
-	if (m_write_cursor + a_vector.size() > m_buffer.size()) {
-		// empty vector of appropriate size
-//		std::cout << "adding " << ((m_write_cursor + a_vector.size()) - m_buffer.size()) << " elements to m_buffer." << std::endl;
-		std::vector<std::uint8_t> l_empty((m_write_cursor + a_vector.size()) - m_buffer.size());
-		m_buffer.insert(m_buffer.end(), l_empty.begin(), l_empty.end());
+	if (m_circular_mode) {
+		ring_write(a_vector.data(), a_vector.size());
+		return;
 	}
-	std::vector<std::uint8_t>::iterator l_dest = m_buffer.begin();
-	std::advance(l_dest, m_write_cursor);
-//	std::cout << "copy to m_write_cursor " << m_write_cursor << std::endl;
-	std::copy(a_vector.begin(), a_vector.end(), l_dest);
-	m_write_cursor += a_vector.size();
+	write_bytes(a_vector.data(), a_vector.size());
 }
 
 void data::fill(std::size_t a_num_bytes, std::uint8_t a_val)
 {
-	std::vector<std::uint8_t> l_pass(a_num_bytes);
-	std::fill(l_pass.begin(), l_pass.end(), a_val);
-	write_raw_data(l_pass);
+	if (m_circular_mode) {
+		std::vector<std::uint8_t> l_pass(a_num_bytes, a_val);
+		ring_write(l_pass.data(), l_pass.size());
+		return;
+	}
+	if (m_write_cursor + a_num_bytes > m_buffer.size())
+		m_buffer.resize(m_write_cursor + a_num_bytes);
+	memset(m_buffer.data() + m_write_cursor, a_val, a_num_bytes);
+	m_write_cursor += a_num_bytes;
 }
 
 void data::random(std::size_t a_num_bytes)
@@ -252,6 +604,8 @@ void data::random(std::size_t a_num_bytes)
 void data::clear()
 {
 	m_buffer.clear();
+	m_ring_head = 0;
+	m_ring_size = 0;
 	m_read_cursor = 0;
 	m_write_cursor = 0;
 	bit_cursor l_clear;
@@ -262,8 +616,12 @@ void data::clear()
 void data::truncate_back(std::size_t a_new_len)
 {
 	// do nothing if our truncation length is greater than the size of the buffer
-	if (a_new_len >= m_buffer.size())
+	if (a_new_len >= size())
+		return;
+	if (m_circular_mode) {
+		m_ring_size = a_new_len;
 		return;
+	}
 		
 	m_buffer.resize(a_new_len);
 	// adjust cursors if necessary
@@ -284,10 +642,14 @@ void data::truncate_back(std::size_t a_new_len)
 void data::truncate_front(std::size_t a_trunc_len)
 {
 	// if truncation length exceeds size of buffer, this is an error!
-	if (a_trunc_len > m_buffer.size()) {
+	if (a_trunc_len > size()) {
 		data_exception e("truncate_front: truncation length exceeds buffer size.");
 		throw (e);
 	}
+	if (m_circular_mode) {
+		ring_consume(a_trunc_len);
+		return;
+	}
 	std::vector<std::uint8_t>::iterator l_new_front = m_buffer.begin();
 	std::advance(l_new_front, a_trunc_len);
 	m_buffer.erase(m_buffer.begin(), l_new_front);
@@ -303,130 +665,363 @@ void data::truncate_front(std::size_t a_trunc_len)
 	// leave the bit cursors alone - beware! Don't use bit read/write routines in circular mode.
 }
 
-void data::assign(const std::uint8_t *a_buffer, std::size_t a_len)
+void data::set_circular_mode(bool a_setting)
 {
-	for (size_t i = 0; i < a_len; ++i) {
-		write_uint8(a_buffer[i]);
+	if (a_setting == m_circular_mode)
+		return;
+	if (a_setting) {
+		// everything in the buffer becomes the unread bytes of the ring
+		m_ring_head = 0;
+		m_ring_size = m_buffer.size();
+		if (m_ring_size > 0)
+			m_buffer.resize(std::bit_ceil(m_ring_size));
+		m_read_cursor = 0;
+		m_write_cursor = 0;
+	} else {
+		circular_linearize();
+		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_ring_head);
+		m_buffer.resize(m_ring_size);
+		m_read_cursor = 0;
+		m_write_cursor = m_ring_size;
+		m_ring_head = 0;
+		m_ring_size = 0;
 	}
+	m_circular_mode = a_setting;
 }
 
-bool data::compare(const data& a_data) const
+void data::ring_reserve(std::size_t a_size)
 {
-	// differ in size? return false
-	if (size() != a_data.size())
-		return false;
-		
-	return (m_buffer == a_data.m_buffer);
+	if (a_size <= m_buffer.size())
+		return;
+	std::vector<std::uint8_t> l_ring(std::bit_ceil(std::max(a_size, (std::size_t)64)));
+	ring_peek(l_ring.data(), 0, m_ring_size);
+	m_buffer.swap(l_ring);
+	m_ring_head = 0;
 }
 
-void data::append_data(const data& a_data)
+void data::ring_peek(std::uint8_t *a_dest, std::size_t a_offset, std::size_t a_len) const
 {
-	set_write_cursor_to_append();
-	write_raw_data(a_data.m_buffer);
+	if (a_len == 0)
+		return;
+	std::size_t l_start = ring_index(a_offset);
+	std::size_t l_first = std::min(a_len, m_buffer.size() - l_start);
+	memcpy(a_dest, m_buffer.data() + l_start, l_first);
+	memcpy(a_dest + l_first, m_buffer.data(), a_len - l_first);
 }
 
-std::size_t data::size() const
+void data::ring_write(const std::uint8_t *a_src, std::size_t a_len)
 {
-	std::int64_t l_size = m_buffer.size();
-	if (l_size < 0) {
-//		data_exception e("got <0 for buffer size");
-//		throw (e);
-//		std::cerr << "data::size got <0!" << std::endl;
-		return 0;
-	} else {
-		return l_size;
-	}
+	if (a_len == 0)
+		return;
+	ring_reserve(m_ring_size + a_len);
+	std::size_t l_tail = ring_index(m_ring_size);
+	std::size_t l_first = std::min(a_len, m_buffer.size() - l_tail);
+	memcpy(m_buffer.data() + l_tail, a_src, l_first);
+	memcpy(m_buffer.data(), a_src + l_first, a_len - l_first);
+	m_ring_size += a_len;
 }
 
-/* operators */
-
-bool data::operator==(const data& rhs) const
+void data::ring_read(std::uint8_t *a_dest, std::size_t a_len)
 {
-	return ((*this <=> rhs) == std::strong_ordering::equivalent);
+	// if number of bytes requested exceeds buffer size, error
+	if (a_len > m_ring_size) {
+		data_exception e("attempt circular mode read larger than buffer size.");
+		throw (e);
+	}
+	ring_peek(a_dest, 0, a_len);
+	ring_consume(a_len);
 }
 
-bool data::operator!=(const data& rhs) const
+void data::ring_consume(std::size_t a_len)
 {
-	return !((*this <=> rhs) == std::strong_ordering::equivalent);
+	m_ring_size -= a_len;
+	// an empty ring starts over at the front, so a reader that keeps up never wraps
+	m_ring_head = (m_ring_size == 0) ? 0 : ring_index(a_len);
 }
 
-std::strong_ordering data::operator<=>(const data& rhs) const
+std::span<const std::uint8_t> data::circular_readable() const
 {
-	// comparison; iterate buffer(s) and return as soon as condition is met
-	// if both buffers are empty, they are equal, so return equivalent
-	if ((this->size() == 0) && (rhs.size() == 0))
-		return std::strong_ordering::equivalent;
-	// if this contains data and rhs is empty, this is > rhs
-	if ((this->size() > 0) && (rhs.size() == 0))
-		return std::strong_ordering::greater;
-	// if this is empty and rhs contains data, then this is < rhs
-	if ((this->size() == 0) && (rhs.size() > 0))
-		return std::strong_ordering::less;
-	// both buffers contain data, compare them byte by byte. if they are stil
-	// equal after comparing the smaller number of bytes, then the larger object
-	// wins as the greater value.
-	std::size_t l_min = std::min(this->size(), rhs.size());
-	for (std::size_t i = 0; i < l_min; ++i) {
-		// first one to have a lesser or greater value wins
-		if (this->m_buffer[i] < rhs.m_buffer[i]) {
-			return std::strong_ordering::less;
-		}
-		if (this->m_buffer[i] > rhs.m_buffer[i]) {
-			return std::strong_ordering::greater;
-		}
+	if (!m_circular_mode) {
+		data_exception e("circular_readable: not in circular mode.");
+		throw (e);
 	}
-	// if we made it here, the first n common bytes of the buffers are equal. Test remaining size
-	if (this->size() < rhs.size())
-		return std::strong_ordering::less;
-	if (this->size() > rhs.size())
-		return std::strong_ordering::greater;
-	// fall through here. buffers are identical in size and contain identical data.
-	return std::strong_ordering::equivalent;
+	if (m_ring_size == 0)
+		return std::span<const std::uint8_t>();
+	return std::span<const std::uint8_t>(m_buffer.data() + m_ring_head, std::min(m_ring_size, m_buffer.size() - m_ring_head));
 }
 
-data& data::operator=(const data& a_data)
+std::span<const std::uint8_t> data::circular_linearize()
 {
-	if (this != &a_data) {
-		copy_construct(a_data);
-	} else {
-		data_exception e("data operator=: Self assignment detected.");
-		throw(e);
+	if (!m_circular_mode) {
+		data_exception e("circular_linearize: not in circular mode.");
+		throw (e);
 	}
-	return *this;
+	return contents();
 }
 
-data& data::operator=(data&& a_data)
+void data::ring_unwrap() const
 {
-	if (this != &a_data) {
-		copy_construct(a_data);
-//		// since we're moving, clear the foreign data object
-//		a_data.clear();
-	} else {
-		data_exception e("data operator=: Self assignment detected.");
-		throw(e);
+	if (m_ring_head + m_ring_size > m_buffer.size()) {
+		std::rotate(m_buffer.begin(), m_buffer.begin() + m_ring_head, m_buffer.end());
+		m_ring_head = 0;
 	}
-	return *this;
 }
 
-data& data::operator+=(const data& a_data)
+std::span<const std::uint8_t> data::contents() const
 {
-	append_data(a_data);
-	return *this;
+	if (!m_circular_mode)
+		return std::span<const std::uint8_t>(m_buffer);
+	ring_unwrap();
+	return std::span<const std::uint8_t>(m_buffer.data() + m_ring_head, m_ring_size);
 }
 
-std::uint8_t& data::operator[](std::size_t index)
+void data::no_circular_mode(const char *a_what) const
 {
-	return m_buffer.at(index);
+	if (m_circular_mode) {
+		data_exception e(std::string(a_what) + ": not available in circular mode.");
+		throw (e);
+	}
 }
 
-/* bits */
+std::uint8_t *data::buffer()
+{
+	contents();
+	return m_buffer.data() + (m_circular_mode ? m_ring_head : 0);
+}
+
+std::span<std::uint8_t> data::circular_writable(std::size_t a_min)
+{
+	if (!m_circular_mode) {
+		data_exception e("circular_writable: not in circular mode.");
+		throw (e);
+	}
+	ring_reserve(m_ring_size + a_min);
+	// free space runs from the tail to the end of the ring, or to the head if the unread bytes wrap
+	std::size_t l_tail = ring_index(m_ring_size);
+	std::size_t l_free = (m_ring_head + m_ring_size < m_buffer.size()) ? m_buffer.size() - l_tail : m_ring_head - l_tail;
+	if (l_free < a_min) {
+		// the ring has room, just not in one piece: move the unread bytes to the front
+		circular_linearize();
+		memmove(m_buffer.data(), m_buffer.data() + m_ring_head, m_ring_size);
+		m_ring_head = 0;
+		l_tail = m_ring_size;
+		l_free = m_buffer.size() - l_tail;
+	}
+	return std::span<std::uint8_t>(m_buffer.data() + l_tail, l_free);
+}
+
+void data::circular_commit(std::size_t a_num_bytes)
+{
+	if (!m_circular_mode || (m_ring_size + a_num_bytes > m_buffer.size())) {
+		data_exception e("circular_commit: more bytes than circular_writable() gave.");
+		throw (e);
+	}
+	m_ring_size += a_num_bytes;
+}
+
+void data::assign(const std::uint8_t *a_buffer, std::size_t a_len)
+{
+	write_bytes(a_buffer, a_len);
+}
+
+void data::append(const std::uint8_t *a_buffer, std::size_t a_len)
+{
+	set_write_cursor_to_append();
+	write_bytes(a_buffer, a_len);
+}
+
+void data::reserve(std::size_t a_capacity)
+{
+	if (m_circular_mode)
+		ring_reserve(a_capacity);
+	else
+		m_buffer.reserve(a_capacity);
+}
+
+std::size_t data::capacity() const
+{
+	return m_circular_mode ? m_buffer.size() : m_buffer.capacity();
+}
+
+void data::shrink_to_fit()
+{
+	if (!m_circular_mode) {
+		m_buffer.shrink_to_fit();
+		return;
+	}
+	// the smallest ring that holds what's unread
+	std::size_t l_size = std::bit_ceil(std::max(m_ring_size, (std::size_t)64));
+	if (l_size < m_buffer.size()) {
+		std::vector<std::uint8_t> l_ring(l_size);
+		ring_peek(l_ring.data(), 0, m_ring_size);
+		m_buffer.swap(l_ring);
+		m_ring_head = 0;
+	}
+}
+
+bool data::compare(const data& a_data) const
+{
+	// differ in size? return false
+	if (size() != a_data.size())
+		return false;
+	if (m_circular_mode || a_data.m_circular_mode)
+		return (*this <=> a_data) == std::strong_ordering::equivalent;
+		
+	return (m_buffer == a_data.m_buffer);
+}
+
+void data::append_data(const data& a_data)
+{
+	if (&a_data == this) {
+		// appending to ourselves would read from a buffer that's being reallocated
+		std::span<const std::uint8_t> l_in = contents();
+		std::vector<std::uint8_t> l_work(l_in.begin(), l_in.end());
+		append(l_work.data(), l_work.size());
+		return;
+	}
+	append(a_data.contents().data(), a_data.size());
+}
+
+void data::append_data(data&& a_data)
+{
+	if (m_buffer.empty() && !m_circular_mode && !a_data.m_circular_mode && (&a_data != this)) {
+		m_buffer.swap(a_data.m_buffer);
+		m_write_cursor = m_buffer.size();
+		a_data.clear();
+		return;
+	}
+	append_data(a_data);
+}
+
+std::size_t data::size() const
+{
+	if (m_circular_mode)
+		return m_ring_size;
+	std::int64_t l_size = m_buffer.size();
+	if (l_size < 0) {
+//		data_exception e("got <0 for buffer size");
+//		throw (e);
+//		std::cerr << "data::size got <0!" << std::endl;
+		return 0;
+	} else {
+		return l_size;
+	}
+}
+
+/* operators */
+
+bool data::operator==(const data& rhs) const
+{
+	return ((*this <=> rhs) == std::strong_ordering::equivalent);
+}
+
+bool data::operator!=(const data& rhs) const
+{
+	return !((*this <=> rhs) == std::strong_ordering::equivalent);
+}
+
+std::strong_ordering data::operator<=>(const data& rhs) const
+{
+	// comparison; iterate buffer(s) and return as soon as condition is met
+	// if both buffers are empty, they are equal, so return equivalent
+	if ((this->size() == 0) && (rhs.size() == 0))
+		return std::strong_ordering::equivalent;
+	// if this contains data and rhs is empty, this is > rhs
+	if ((this->size() > 0) && (rhs.size() == 0))
+		return std::strong_ordering::greater;
+	// if this is empty and rhs contains data, then this is < rhs
+	if ((this->size() == 0) && (rhs.size() > 0))
+		return std::strong_ordering::less;
+	// both buffers contain data, compare them byte by byte. if they are stil
+	// equal after comparing the smaller number of bytes, then the larger object
+	// wins as the greater value.
+	std::size_t l_min = std::min(this->size(), rhs.size());
+	auto l_byte = [](const data& a_data, std::size_t a_index) { return a_data.m_circular_mode ? a_data.m_buffer[a_data.ring_index(a_index)] : a_data.m_buffer[a_index]; };
+	for (std::size_t i = 0; i < l_min; ++i) {
+		// first one to have a lesser or greater value wins
+		if (l_byte(*this, i) < l_byte(rhs, i)) {
+			return std::strong_ordering::less;
+		}
+		if (l_byte(*this, i) > l_byte(rhs, i)) {
+			return std::strong_ordering::greater;
+		}
+	}
+	// if we made it here, the first n common bytes of the buffers are equal. Test remaining size
+	if (this->size() < rhs.size())
+		return std::strong_ordering::less;
+	if (this->size() > rhs.size())
+		return std::strong_ordering::greater;
+	// fall through here. buffers are identical in size and contain identical data.
+	return std::strong_ordering::equivalent;
+}
+
+data& data::operator=(const data& a_data)
+{
+	if (this != &a_data) {
+		copy_construct(a_data);
+	} else {
+		data_exception e("data operator=: Self assignment detected.");
+		throw(e);
+	}
+	return *this;
+}
+
+data& data::operator=(data&& a_data)
+{
+	if (this != &a_data) {
+		move_construct(a_data);
+	} else {
+		data_exception e("data operator=: Self assignment detected.");
+		throw(e);
+	}
+	return *this;
+}
+
+data& data::operator+=(const data& a_data)
+{
+	append_data(a_data);
+	return *this;
+}
+
+data& data::operator+=(data&& a_data)
+{
+	append_data(std::move(a_data));
+	return *this;
+}
+
+data operator+(const data& a_lhs, const data& a_rhs)
+{
+	data l_ret;
+	l_ret.reserve(a_lhs.size() + a_rhs.size());
+	l_ret = a_lhs; // copy assignment keeps the storage reserved above
+	l_ret.append_data(a_rhs);
+	return l_ret;
+}
+
+data operator+(data&& a_lhs, const data& a_rhs)
+{
+	a_lhs.append_data(a_rhs);
+	return data(std::move(a_lhs));
+}
+
+std::uint8_t& data::operator[](std::size_t index)
+{
+	if (m_circular_mode) {
+		if (index >= m_ring_size)
+			throw std::out_of_range("data::operator[]: index past the unread bytes.");
+		return m_buffer[ring_index(index)];
+	}
+	return m_buffer.at(index);
+}
+
+/* bits */
 
 void data::set_read_bit_cursor(bit_cursor a_bit_cursor)
 {
-	if (a_bit_cursor.byte < m_buffer.size()) {
+	if (a_bit_cursor.byte < size()) {
 		m_read_bit_cursor = a_bit_cursor;
 	} else {
-		if ((a_bit_cursor.byte == m_buffer.size()) && (a_bit_cursor.bit == 7)) {
+		if ((a_bit_cursor.byte == size()) && (a_bit_cursor.bit == 7)) {
 			m_read_bit_cursor = a_bit_cursor;
 		} else {
 			data_exception e("attempt to set read bit cursor past end of buffer.");
@@ -437,6 +1032,7 @@ void data::set_read_bit_cursor(bit_cursor a_bit_cursor)
 
 void data::set_write_bit_cursor(bit_cursor a_bit_cursor)
 {
+	no_circular_mode("set_write_bit_cursor");
 	if (a_bit_cursor.byte < m_buffer.size()) {
 		m_write_bit_cursor = a_bit_cursor;
 	} else {
@@ -471,6 +1067,7 @@ const std::uint8_t data::byte_mask[] = { 0xfe, 0xfd, 0xfb, 0xf7, 0xef, 0xdf, 0xb
 
 void data::write_bit(bool a_bit)
 {
+	no_circular_mode("write_bit");
 	// make masks
 	std::uint8_t l_and = byte_mask[m_write_bit_cursor.bit];
 	std::uint8_t l_or = l_and ^ 0xff;
@@ -514,32 +1111,22 @@ void data::write_bits(std::uint64_t a_bits, std::uint16_t a_count)
 		throw (e);
 	}
 
-	// shift everything over all the way to the left
-	a_bits <<= (64 - a_count);
-
-	// feed them into write_bit one at a time.
-	// Note: A logical improvement to this routine would involve shifting the bits over
-	// within a 5 byte frame to overlay the next bit write position, so the 3 inner bytes can be copied
-	// directly and the two outer bytes can be and/ored. This temporary solution may prove to be fast
-	// enough however.
-
-	while (a_count > 0) {
-		write_bit((a_bits & 0x8000000000000000ULL) > 0);
-		a_bits <<= 1;
-		--a_count;
-	}
+	// hand the whole field to a bit_writer, which overlays it on the buffer a word at a time
+	// and moves our write bit cursor when it goes out of scope
+	bit_writer l_writer(*this);
+	l_writer.write_bits(a_bits, a_count);
 }
 
 bool data::read_bit()
 {
 	// if this read will push us past the end of the buffer, throw an exception
-	if (m_read_bit_cursor.byte >= m_buffer.size()) {
+	if (m_read_bit_cursor.byte >= size()) {
 		data_exception e("read_bit: Attempt cursor-mode read past end of buffer.");
 		throw(e);
 	}
 
 	std::uint8_t l_mask = byte_mask[m_read_bit_cursor.bit] ^ 0xff;
-	std::uint8_t l_byte = m_buffer[m_read_bit_cursor.byte] & l_mask;
+	std::uint8_t l_byte = contents()[m_read_bit_cursor.byte] & l_mask;
 
 	// advance the read cursor
 	if (m_read_bit_cursor.bit > 0) {
@@ -560,14 +1147,9 @@ std::uint64_t data::read_bits(std::uint16_t a_count)
 		throw (e);
 	}
 
-	std::uint64_t l_ret = 0;
-
-	while (a_count > 0) {
-		l_ret <<= 1;
-		if (read_bit())
-			l_ret |= 0x0000000000000001ULL;
-		--a_count;
-	}
+	bit_reader l_reader(*this, m_read_bit_cursor);
+	std::uint64_t l_ret = l_reader.read_bits(a_count);
+	m_read_bit_cursor = l_reader.get_bit_cursor();
 	return l_ret;
 }
 
@@ -576,7 +1158,7 @@ std::string data::as_bits()
 	std::string l_ret;
 	
 	// does not disturb bit cursors
-	for (std::uint8_t& i : m_buffer) {
+	for (std::uint8_t i : contents()) {
 		std::uint8_t l_work = i;
 		for (int j = 0; j <= 7; ++j) {
 			if (l_work & 0x80) {
@@ -628,532 +1210,315 @@ void data::set_read_cursor(std::size_t a_read_cursor)
 	m_read_cursor = a_read_cursor;
 }
 
+// the scalar accessors' way in and out of m_buffer: one bounds check and a copy, no temporary vector
+
+void data::write_bytes(const void *a_src, std::size_t a_num_bytes)
+{
+	// nothing to copy, and an empty buffer's data() may be null, which memcpy doesn't allow
+	if (a_num_bytes == 0)
+		return;
+	if (m_circular_mode) {
+		ring_write((const std::uint8_t *)a_src, a_num_bytes);
+		return;
+	}
+	if (m_write_cursor + a_num_bytes > m_buffer.size())
+		m_buffer.resize(m_write_cursor + a_num_bytes);
+	memcpy(m_buffer.data() + m_write_cursor, a_src, a_num_bytes);
+	m_write_cursor += a_num_bytes;
+}
+
+void data::read_bytes(void *a_dest, std::size_t a_num_bytes)
+{
+	if (a_num_bytes == 0)
+		return;
+	if (m_circular_mode) {
+		ring_read((std::uint8_t *)a_dest, a_num_bytes);
+	} else {
+		// normal mode read
+		if (m_read_cursor + a_num_bytes > m_buffer.size()) {
+			data_exception e("attempt to read past end of buffer.");
+			throw (e);
+		}
+		memcpy(a_dest, m_buffer.data() + m_read_cursor, a_num_bytes);
+		m_read_cursor += a_num_bytes;
+	}
+}
+
+template <typename T> void data::write_scalar(T a_val)
+{
+	if ((std::endian::native == std::endian::little) && m_network_byte_order)
+		a_val = std::byteswap(a_val);
+	write_bytes(&a_val, sizeof(T));
+}
+
+template <typename T> T data::read_scalar()
+{
+	T l_ret;
+	read_bytes(&l_ret, sizeof(T));
+	if ((std::endian::native == std::endian::little) && m_network_byte_order)
+		l_ret = std::byteswap(l_ret);
+	return l_ret;
+}
+
+void data::write_narrow(std::uint64_t a_val, std::size_t a_num_bytes)
+{
+	// the low a_num_bytes bytes of a_val, most significant first in network (or big endian host) order
+	bool l_big = (std::endian::native == std::endian::big) || m_network_byte_order;
+	std::uint8_t l_raw[8];
+	for (std::size_t i = 0; i < a_num_bytes; ++i)
+		l_raw[i] = (a_val >> (8 * (l_big ? a_num_bytes - 1 - i : i))) & 0xff;
+	write_bytes(l_raw, a_num_bytes);
+}
+
+std::uint64_t data::read_narrow(std::size_t a_num_bytes, bool a_signed)
+{
+	std::uint8_t l_raw[8];
+	read_bytes(l_raw, a_num_bytes);
+	return narrow_value(l_raw, a_num_bytes, (std::endian::native == std::endian::big) || m_network_byte_order, a_signed);
+}
+
+std::uint64_t data::narrow_value(const std::uint8_t *l_raw, std::size_t a_num_bytes, bool l_big, bool a_signed)
+{
+	std::uint64_t l_ret = 0;
+	for (std::size_t i = 0; i < a_num_bytes; ++i)
+		l_ret |= (std::uint64_t)l_raw[i] << (8 * (l_big ? a_num_bytes - 1 - i : i));
+	if (a_signed && ((l_ret >> (8 * a_num_bytes - 1)) & 1)) // sign extension
+		l_ret |= ~0ULL << (8 * a_num_bytes);
+	return l_ret;
+}
+
 // 8
 
 void data::write_uint8(std::uint8_t a_uint8)
 {
-	std::vector<std::uint8_t> l_pass;
-	l_pass.push_back(a_uint8);
-	write_raw_data(l_pass);
+	write_bytes(&a_uint8, 1);
 }
 
 std::uint8_t data::read_uint8()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::uint8_t));
-	size1_union l_ret;
-	l_ret.uint8_val = l_read[0];
-	return l_ret.uint8_val;
+	std::uint8_t l_ret;
+	read_bytes(&l_ret, 1);
+	return l_ret;
 }
 
 void data::write_int8(std::int8_t a_int8)
 {
-	std::vector<std::uint8_t> l_pass;
-	size1_union l_work;
-	l_work.int8_val = a_int8;
-	l_pass.push_back(l_work.uint8_val);
-	write_raw_data(l_pass);
+	write_bytes(&a_int8, 1);
 }
 
 std::int8_t data::read_int8()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::uint8_t));
-	size1_union l_ret;
-	l_ret.uint8_val = l_read[0];
-	return l_ret.int8_val;
+	std::int8_t l_ret;
+	read_bytes(&l_ret, 1);
+	return l_ret;
 }
 
 // 16
 
 void data::write_uint16(std::uint16_t a_uint16)
 {
-	std::vector<std::uint8_t> l_pass;
-	size2_union l_work;
-	l_work.uint16_val = a_uint16;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.uint16_val = std::byteswap(l_work.uint16_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 2);
-	write_raw_data(l_pass);
+	write_scalar(a_uint16);
 }
 
 std::uint16_t data::read_uint16()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::uint16_t));
-	size2_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint16_val = std::byteswap(l_ret.uint16_val);
-	}
-	return l_ret.uint16_val;
+	return read_scalar<std::uint16_t>();
 }
 
 void data::write_int16(std::int16_t a_int16)
 {
-	std::vector<std::uint8_t> l_pass;
-	size2_union l_work;
-	l_work.int16_val = a_int16;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.int16_val = std::byteswap(l_work.int16_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 2);
-	write_raw_data(l_pass);
+	write_scalar(a_int16);
 }
 
 std::int16_t data::read_int16()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::int16_t));
-	size2_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.int16_val = std::byteswap(l_ret.int16_val);
-	}
-	return l_ret.int16_val;
+	return read_scalar<std::int16_t>();
 }
 
 // 32
 
 void data::write_uint32(std::uint32_t a_uint32)
 {
-	std::vector<std::uint8_t> l_pass;
-	size4_union l_work;
-	l_work.uint32_val = a_uint32;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.uint32_val = std::byteswap(l_work.uint32_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 4);
-	write_raw_data(l_pass);
+	write_scalar(a_uint32);
 }
 
 std::uint32_t data::read_uint32()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::uint32_t));
-	size4_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint32_val = std::byteswap(l_ret.uint32_val);
-	}
-	return l_ret.uint32_val;
+	return read_scalar<std::uint32_t>();
 }
 
 void data::write_int32(std::int32_t a_int32)
 {
-	std::vector<std::uint8_t> l_pass;
-	size4_union l_work;
-	l_work.int32_val = a_int32;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.int32_val = std::byteswap(l_work.int32_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 4);
-	write_raw_data(l_pass);
+	write_scalar(a_int32);
 }
 
 std::int32_t data::read_int32()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::int32_t));
-	size4_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.int32_val = std::byteswap(l_ret.int32_val);
-	}
-	return l_ret.int32_val;
+	return read_scalar<std::int32_t>();
 }
 
 // 64
 
 void data::write_uint64(std::uint64_t a_uint64)
 {
-	std::vector<std::uint8_t> l_pass;
-	size8_union l_work;
-	l_work.uint64_val = a_uint64;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.uint64_val = std::byteswap(l_work.uint64_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 8);
-	write_raw_data(l_pass);
+	write_scalar(a_uint64);
 }
 
 std::uint64_t data::read_uint64()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::uint64_t));
-	size8_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint64_val = std::byteswap(l_ret.uint64_val);
-	}
-	return l_ret.uint64_val;
+	return read_scalar<std::uint64_t>();
 }
 
 void data::write_int64(std::int64_t a_int64)
 {
-	std::vector<std::uint8_t> l_pass;
-	size8_union l_work;
-	l_work.int64_val = a_int64;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.int64_val = std::byteswap(l_work.int64_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 8);
-	write_raw_data(l_pass);
+	write_scalar(a_int64);
 }
 
 std::int64_t data::read_int64()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(std::int64_t));
-	size8_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.int64_val = std::byteswap(l_ret.int64_val);
-	}
-	return l_ret.int64_val;
+	return read_scalar<std::int64_t>();
 }
 
 // specializations
 
 void data::write_uint24(std::uint32_t a_uint32)
 {
-	std::vector<std::uint8_t> l_pass;
-	size4_union l_work;
-	l_work.uint32_val = a_uint32;
-	if (l_work.uint32_val > 16777215) {
+	if (a_uint32 > 16777215) {
 		data_exception e("uint24 value should not exceed 16777215.");
 		throw (e);
 	}
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.uint32_val = std::byteswap(l_work.uint32_val);
-	}
-	if ((std::endian::native == std::endian::big) || m_network_byte_order) {
-		l_pass.assign(l_work.raw + 1, l_work.raw + 4);
-	} else {
-		l_pass.assign(l_work.raw, l_work.raw + 3);
-	}
-	write_raw_data(l_pass);	
+	write_narrow(a_uint32, 3);
 }
 
 std::uint32_t data::read_uint24()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(3);
-	size4_union l_ret;
-	l_ret.uint32_val = 0;
-	if (m_network_byte_order) {
-		l_read.insert(l_read.begin(), 0x00);
-	} else {
-		l_read.push_back(0x00);
-	}
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint32_val = std::byteswap(l_ret.uint32_val);
-	}
-	return l_ret.uint32_val;	
+	return (std::uint32_t)read_narrow(3, false);
 }
 
 void data::write_int24(std::int32_t a_int32)
 {
-	std::vector<std::uint8_t> l_pass;
-	size4_union l_work;
-	l_work.int32_val = a_int32;
-	if (l_work.int32_val > 8388607) {
+	if (a_int32 > 8388607) {
 		data_exception e("int24 value should not exceed 8388607.");
 		throw (e);
 	}
-	if (l_work.int32_val < -8388608) {
+	if (a_int32 < -8388608) {
 		data_exception e("int24 value should not be less than -8388608.");
 		throw (e);
 	}
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.int32_val = std::byteswap(l_work.int32_val);
-	}
-	if ((std::endian::native == std::endian::big) || m_network_byte_order) {
-		l_pass.assign(l_work.raw + 1, l_work.raw + 4);
-	} else {
-		l_pass.assign(l_work.raw, l_work.raw + 3);
-	}
-	write_raw_data(l_pass);		
+	write_narrow((std::uint32_t)a_int32, 3);
 }
 
 std::int32_t data::read_int24()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(3);
-	size4_union l_ret;
-	l_ret.int32_val = 0;
-	if (m_network_byte_order) {
-		if ((l_read[0] & 0x80) > 0) // sign extension
-			l_read.insert(l_read.begin(), 0xff);
-		else
-			l_read.insert(l_read.begin(), 0x00);
-	} else {
-		if ((l_read[2] & 0x80) > 0)
-			l_read.push_back(0xff);
-		else
-			l_read.push_back(0x00);
-	}
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.int32_val = std::byteswap(l_ret.int32_val);
-	}
-	return l_ret.int32_val;	
+	return (std::int32_t)read_narrow(3, true);
 }
 
 // 40 bit integers
 
 void data::write_uint40(std::uint64_t a_uint64)
 {
-	std::vector<std::uint8_t> l_pass;
-	size8_union l_work;
-	l_work.uint64_val = a_uint64;
-	if (l_work.uint64_val > 1099511627775ULL) {
+	if (a_uint64 > 1099511627775ULL) {
 		data_exception e("uint40 value should not exceed 1099511627775.");
 		throw (e);
 	}
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.uint64_val = std::byteswap(l_work.uint64_val);
-	}
-	if ((std::endian::native == std::endian::big) || m_network_byte_order) {
-		l_pass.assign(l_work.raw + 3, l_work.raw + 8);
-	} else {
-		l_pass.assign(l_work.raw, l_work.raw + 5);
-	}
-	write_raw_data(l_pass);	
+	write_narrow(a_uint64, 5);
 }
 
 std::uint64_t data::read_uint40()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(5);
-	size8_union l_ret;
-	l_ret.uint64_val = 0;
-	if (m_network_byte_order) {
-		l_read.insert(l_read.begin(), 0x00);
-		l_read.insert(l_read.begin(), 0x00);
-		l_read.insert(l_read.begin(), 0x00);
-	} else {
-		l_read.push_back(0x00);
-		l_read.push_back(0x00);
-		l_read.push_back(0x00);
-	}
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint64_val = std::byteswap(l_ret.uint64_val);
-	}
-	return l_ret.uint64_val;	
+	return read_narrow(5, false);
 }
 
 void data::write_int40(std::int64_t a_int64)
 {
-	std::vector<std::uint8_t> l_pass;
-	size8_union l_work;
-	l_work.int64_val = a_int64;
-	if (l_work.int64_val > 549755813887LL) {
+	if (a_int64 > 549755813887LL) {
 		data_exception e("int440value should not exceed 549755813887.");
 		throw (e);
 	}
-	if (l_work.int64_val < -549755813888LL) {
+	if (a_int64 < -549755813888LL) {
 		data_exception e("int40 value should not be less than -549755813888.");
 		throw (e);
 	}
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.int64_val = std::byteswap(l_work.int64_val);
-	}
-	if ((std::endian::native == std::endian::big) || m_network_byte_order) {
-		l_pass.assign(l_work.raw + 3, l_work.raw + 8);
-	} else {
-		l_pass.assign(l_work.raw, l_work.raw + 5);
-	}
-	write_raw_data(l_pass);		
+	write_narrow(a_int64, 5);
 }
 
 std::int64_t data::read_int40()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(5);
-	size8_union l_ret;
-	l_ret.int64_val = 0;
-	if (m_network_byte_order) {
-		if ((l_read[0] & 0x80) > 0) { // sign extension
-			l_read.insert(l_read.begin(), 0xff);
-			l_read.insert(l_read.begin(), 0xff);
-			l_read.insert(l_read.begin(), 0xff);
-		} else {
-			l_read.insert(l_read.begin(), 0x00);
-			l_read.insert(l_read.begin(), 0x00);
-			l_read.insert(l_read.begin(), 0x00);
-		}
-	} else {
-		if ((l_read[4] & 0x80) > 0) {
-			l_read.push_back(0xff);
-			l_read.push_back(0xff);
-			l_read.push_back(0xff);
-		} else {
-			l_read.push_back(0x00);
-			l_read.push_back(0x00);
-			l_read.push_back(0x00);
-		}
-	}
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.int64_val = std::byteswap(l_ret.int64_val);
-	}
-	return l_ret.int64_val;	
+	return (std::int64_t)read_narrow(5, true);
 }
 
 // 48 bit integers
 
 void data::write_uint48(std::uint64_t a_uint64)
 {
-	std::vector<std::uint8_t> l_pass;
-	size8_union l_work;
-	l_work.uint64_val = a_uint64;
-	if (l_work.uint64_val > 281474976710655ULL) {
+	if (a_uint64 > 281474976710655ULL) {
 		data_exception e("uint48 value should not exceed 281474976710655.");
 		throw (e);
 	}
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.uint64_val = std::byteswap(l_work.uint64_val);
-	}
-	if ((std::endian::native == std::endian::big) || m_network_byte_order) {
-		l_pass.assign(l_work.raw + 2, l_work.raw + 8);
-	} else {
-		l_pass.assign(l_work.raw, l_work.raw + 6);
-	}
-	write_raw_data(l_pass);	
+	write_narrow(a_uint64, 6);
 }
 
 std::uint64_t data::read_uint48()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(6);
-	size8_union l_ret;
-	l_ret.uint64_val = 0;
-	if (m_network_byte_order) {
-		l_read.insert(l_read.begin(), 0x00);
-		l_read.insert(l_read.begin(), 0x00);
-	} else {
-		l_read.push_back(0x00);
-		l_read.push_back(0x00);
-	}
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint64_val = std::byteswap(l_ret.uint64_val);
-	}
-	return l_ret.uint64_val;		
+	return read_narrow(6, false);
 }
 
 void data::write_int48(std::int64_t a_int64)
 {
-	std::vector<std::uint8_t> l_pass;
-	size8_union l_work;
-	l_work.int64_val = a_int64;
-	if (l_work.int64_val > 140737488355327LL) {
+	if (a_int64 > 140737488355327LL) {
 		data_exception e("int48 value should not exceed 140737488355327.");
 		throw (e);
 	}
-	if (l_work.int64_val < -140737488355328LL) {
+	if (a_int64 < -140737488355328LL) {
 		data_exception e("int48 value should not be less than -140737488355328.");
 		throw (e);
 	}
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_work.int64_val = std::byteswap(l_work.int64_val);
-	}
-	if ((std::endian::native == std::endian::big) || m_network_byte_order) {
-		l_pass.assign(l_work.raw + 2, l_work.raw + 8);
-	} else {
-		l_pass.assign(l_work.raw, l_work.raw + 6);
-	}
-	write_raw_data(l_pass);		
+	write_narrow(a_int64, 6);
 }
 
 std::int64_t data::read_int48()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(6);
-	size8_union l_ret;
-	l_ret.int64_val = 0;
-	if (m_network_byte_order) {
-		if ((l_read[0] & 0x80) > 0) { // sign extension
-			l_read.insert(l_read.begin(), 0xff);
-			l_read.insert(l_read.begin(), 0xff);
-		} else {
-			l_read.insert(l_read.begin(), 0x00);
-			l_read.insert(l_read.begin(), 0x00);
-		}
-	} else {
-		if ((l_read[4] & 0x80) > 0) {
-			l_read.push_back(0xff);
-			l_read.push_back(0xff);
-		} else {
-			l_read.push_back(0x00);
-			l_read.push_back(0x00);
-		}
-	}
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.int64_val = std::byteswap(l_ret.int64_val);
-	}
-	return l_ret.int64_val;	
+	return (std::int64_t)read_narrow(6, true);
 }
 
 // floats
 
 void data::write_float(float a_float)
 {
-	std::vector<std::uint8_t> l_pass;
-	size4_union l_work;
-	l_work.float_val = a_float;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		// note: std::byteswap doesn't appear to work with float
-		l_work.uint32_val = std::byteswap(l_work.uint32_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 4);
-	write_raw_data(l_pass);
+	// std::byteswap only takes integers, so swap the bits as one
+	write_scalar(std::bit_cast<std::uint32_t>(a_float));
 }
 
 float data::read_float()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(float));
-	size4_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint32_val = std::byteswap(l_ret.uint32_val);
-	}
-	return l_ret.float_val;
+	return std::bit_cast<float>(read_scalar<std::uint32_t>());
 }
 
 void data::write_double(double a_double)
 {
-	std::vector<std::uint8_t> l_pass;
-	size8_union l_work;
-	l_work.double_val = a_double;
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		// note: std::byteswap doesn't appear to work with float
-		l_work.uint64_val = std::byteswap(l_work.uint64_val);
-	}
-	l_pass.assign(l_work.raw, l_work.raw + 8);
-	write_raw_data(l_pass);
+	write_scalar(std::bit_cast<std::uint64_t>(a_double));
 }
 
 double data::read_double()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(double));
-	size8_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
-	if ((std::endian::native == std::endian::little) && m_network_byte_order) {
-		l_ret.uint64_val = std::byteswap(l_ret.uint64_val);
-	}
-	return l_ret.double_val;
+	return std::bit_cast<double>(read_scalar<std::uint64_t>());
 }
 
 void data::write_longdouble(long double a_longdouble)
 {
-	std::vector<std::uint8_t> l_pass;
 	size16_union l_work;
 	l_work.longdouble_val = a_longdouble;
 	// zero out bytes 10-15 of the long double (not used anyway)
 	// to shut up Valgrind's uninitialized value error
 	for (std::size_t i = 10; i < 16; ++i)
 		l_work.raw[i] = 0;
-	l_pass.assign(l_work.raw, l_work.raw + 16);
-	write_raw_data(l_pass);
+	write_bytes(l_work.raw, 16);
 }
 
 long double data::read_longdouble()
 {
-	std::vector<std::uint8_t> l_read = read_raw_data(sizeof(long double));
 	size16_union l_ret;
-	std::copy(l_read.begin(), l_read.end(), l_ret.raw);
+	read_bytes(l_ret.raw, sizeof(long double));
 	return l_ret.longdouble_val;
 }
 
@@ -1311,7 +1676,7 @@ std::string data::read_base64(std::size_t a_len)
 std::string data::as_base64()
 {
 	// return entire buffer as base64, without disturbing the cursors
-	std::string ret = base64_str(m_buffer.data(), m_buffer.size());
+	std::string ret = base64_str(contents().data(), size());
 	return ret;
 }
 
@@ -1389,103 +1754,457 @@ const std::uint32_t data::crc32_tab[] = {
 	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-std::uint32_t data::crc32(std::uint32_t a_crc)
+const std::array<std::array<std::uint32_t, 256>, 8>& data::crc32_slice_tab()
 {
-	const std::uint8_t *p;
-	std::size_t size = m_buffer.size();
+	// table k gives the effect of a byte followed by k zero bytes, so 8 bytes can be folded in with 8 lookups
+	// that don't depend on each other instead of 8 that do
+	static const std::array<std::array<std::uint32_t, 256>, 8> l_tab = []() {
+		std::array<std::array<std::uint32_t, 256>, 8> l_ret;
+		for (std::size_t i = 0; i < 256; ++i)
+			l_ret[0][i] = crc32_tab[i];
+		for (std::size_t k = 1; k < 8; ++k)
+			for (std::size_t i = 0; i < 256; ++i)
+				l_ret[k][i] = (l_ret[k - 1][i] >> 8) ^ crc32_tab[l_ret[k - 1][i] & 0xff];
+		return l_ret;
+	}();
+	return l_tab;
+}
 
-	p = m_buffer.data();
+std::uint32_t data::crc32(std::uint32_t a_crc, const std::uint8_t *a_data, std::size_t a_len)
+{
+	const std::array<std::array<std::uint32_t, 256>, 8>& l_tab = crc32_slice_tab();
+	const std::uint8_t *p = a_data;
 	a_crc = a_crc ^ ~0U;
 
-	while (size--)
+	while (a_len >= 8) {
+		std::uint32_t l_lo, l_hi;
+		memcpy(&l_lo, p, 4);
+		memcpy(&l_hi, p + 4, 4);
+		if (std::endian::native == std::endian::big) {
+			l_lo = std::byteswap(l_lo);
+			l_hi = std::byteswap(l_hi);
+		}
+		l_lo ^= a_crc;
+		a_crc = l_tab[7][l_lo & 0xff] ^ l_tab[6][(l_lo >> 8) & 0xff] ^ l_tab[5][(l_lo >> 16) & 0xff] ^ l_tab[4][l_lo >> 24]
+			^ l_tab[3][l_hi & 0xff] ^ l_tab[2][(l_hi >> 8) & 0xff] ^ l_tab[1][(l_hi >> 16) & 0xff] ^ l_tab[0][l_hi >> 24];
+		p += 8;
+		a_len -= 8;
+	}
+	while (a_len--)
 		a_crc = crc32_tab[(a_crc ^ *p++) & 0xFF] ^ (a_crc >> 8);
 
 	return a_crc ^ ~0U;
 }
 
-data data::md5()
+std::uint32_t data::crc32(std::uint32_t a_crc) const
 {
-	data l_digest;
-	l_digest.fill(16, 0); // empty space to hold digest
-	MD5_CTX l_ctx;
-	MD5Init(&l_ctx);
-	MD5Update(&l_ctx, (unsigned char *)m_buffer.data(), m_buffer.size());
-	MD5Final(l_digest.m_buffer.data(), &l_ctx);
-	l_digest.m_read_cursor = 0;
-	l_digest.m_write_cursor = 0;
-	return l_digest;
+	return crc32(a_crc, contents().data(), size());
 }
 
-data data::sha1()
+std::uint32_t data::crc32_range(std::uint32_t a_crc, std::size_t a_offset, std::size_t a_len) const
 {
-	data l_digest;
-	SHA1Context l_ctx;
-	SHA1Reset(&l_ctx);
-	SHA1Input(&l_ctx, (unsigned char *)m_buffer.data(), m_buffer.size());
-	SHA1Result(&l_ctx);
-	l_digest.set_network_byte_order(true);
-	l_digest.write_uint32(l_ctx.Message_Digest[0]);
-	l_digest.write_uint32(l_ctx.Message_Digest[1]);
-	l_digest.write_uint32(l_ctx.Message_Digest[2]);
-	l_digest.write_uint32(l_ctx.Message_Digest[3]);
-	l_digest.write_uint32(l_ctx.Message_Digest[4]);
-	l_digest.set_read_cursor(0);
-	l_digest.set_write_cursor(0);
-	return l_digest;
+	if ((a_offset > size()) || (a_len > size() - a_offset)) {
+		data_exception e("crc32_range: Range runs past end of buffer.");
+		throw (e);
+	}
+	return crc32(a_crc, contents().data() + a_offset, a_len);
 }
 
-data data::sha2_224()
+data data::md5() const
 {
-	data l_digest;
-	l_digest.fill(28, 0); // empty space to hold digest
-	sha224_ctx l_ctx;
-	sha224_init(&l_ctx);
-	sha224_update(&l_ctx, (const uint8_t *)m_buffer.data(), m_buffer.size());
-	sha224_final(&l_ctx, l_digest.m_buffer.data());
-	l_digest.set_read_cursor(0);
-	l_digest.set_write_cursor(0);
-	return l_digest;
+	hasher l_hasher(HASH_MD5);
+	l_hasher.update(*this);
+	return l_hasher.finish();
 }
 
-data data::sha2_256()
+data data::sha1() const
 {
-	data l_digest;
-	l_digest.fill(32, 0); // empty space to hold digest
-	sha256_ctx l_ctx;
-	sha256_init(&l_ctx);
-	sha256_update(&l_ctx, (const uint8_t *)m_buffer.data(), m_buffer.size());
-	sha256_final(&l_ctx, l_digest.m_buffer.data());
-	l_digest.set_read_cursor(0);
-	l_digest.set_write_cursor(0);
-	return l_digest;
+	hasher l_hasher(HASH_SHA1);
+	l_hasher.update(*this);
+	return l_hasher.finish();
+}
+
+data data::sha2_224() const
+{
+	hasher l_hasher(HASH_SHA2_224);
+	l_hasher.update(*this);
+	return l_hasher.finish();
+}
+
+data data::sha2_256() const
+{
+	hasher l_hasher(HASH_SHA2_256);
+	l_hasher.update(*this);
+	return l_hasher.finish();
+}
+
+data data::sha2_384() const
+{
+	hasher l_hasher(HASH_SHA2_384);
+	l_hasher.update(*this);
+	return l_hasher.finish();
+}
+
+data data::sha2_512() const
+{
+	hasher l_hasher(HASH_SHA2_512);
+	l_hasher.update(*this);
+	return l_hasher.finish();
+}
+
+data::hasher::hasher(hash_type a_type)
+: m_type(a_type)
+{
+	reset();
+}
+
+void data::hasher::reset()
+{
+	switch (m_type) {
+		case HASH_MD5:
+			MD5Init(&m_md5);
+			break;
+		case HASH_SHA1:
+			SHA1Reset(&m_sha1);
+			break;
+		case HASH_SHA2_224:
+			sha224_init(&m_sha256);
+			break;
+		case HASH_SHA2_256:
+			sha256_init(&m_sha256);
+			break;
+		case HASH_SHA2_384:
+			sha384_init(&m_sha512);
+			break;
+		case HASH_SHA2_512:
+			sha512_init(&m_sha512);
+			break;
+		default:
+			data_exception e("hasher: unknown hash type.");
+			throw(e);
+	}
+}
+
+std::size_t data::hasher::digest_size() const
+{
+	const std::array<std::size_t, 6> l_sizes = { 16, 20, SHA224_DIGEST_SIZE, SHA256_DIGEST_SIZE, SHA384_DIGEST_SIZE, SHA512_DIGEST_SIZE };
+	return l_sizes[m_type];
+}
+
+void data::hasher::update(const std::uint8_t *a_in, std::size_t a_len)
+{
+	// the C implementations take unsigned int lengths, so feed them at most 1GB at a time
+	const std::size_t l_max = 1 << 30;
+	while (a_len > 0) {
+		unsigned int l_len = std::min(a_len, l_max);
+		switch (m_type) {
+			case HASH_MD5:
+				MD5Update(&m_md5, (unsigned char *)a_in, l_len);
+				break;
+			case HASH_SHA1:
+				SHA1Input(&m_sha1, a_in, l_len);
+				break;
+			case HASH_SHA2_224:
+				sha224_update(&m_sha256, a_in, l_len);
+				break;
+			case HASH_SHA2_256:
+				sha256_update(&m_sha256, a_in, l_len);
+				break;
+			case HASH_SHA2_384:
+				sha384_update(&m_sha512, a_in, l_len);
+				break;
+			case HASH_SHA2_512:
+				sha512_update(&m_sha512, a_in, l_len);
+				break;
+		}
+		a_in += l_len;
+		a_len -= l_len;
+	}
+}
+
+void data::hasher::update(const data& a_data, std::size_t a_offset, std::size_t a_len)
+{
+	if ((a_offset > a_data.size()) || (a_len > a_data.size() - a_offset)) {
+		data_exception e("hasher: Range runs past end of buffer.");
+		throw (e);
+	}
+	update(a_data.contents().data() + a_offset, a_len);
 }
 
-data data::sha2_384()
+data data::hasher::finish()
 {
 	data l_digest;
-	l_digest.fill(48, 0); // empty space to hold digest
-	sha384_ctx l_ctx;
-	sha384_init(&l_ctx);
-	sha384_update(&l_ctx, (const uint8_t *)m_buffer.data(), m_buffer.size());
-	sha384_final(&l_ctx, l_digest.m_buffer.data());
+	l_digest.fill(digest_size(), 0); // empty space to hold digest
+	switch (m_type) {
+		case HASH_MD5:
+			MD5Final(l_digest.m_buffer.data(), &m_md5);
+			break;
+		case HASH_SHA1:
+			SHA1Result(&m_sha1);
+			l_digest.set_network_byte_order(true);
+			l_digest.set_write_cursor(0);
+			for (std::size_t i = 0; i < 5; ++i)
+				l_digest.write_uint32(m_sha1.Message_Digest[i]);
+			break;
+		case HASH_SHA2_224:
+			sha224_final(&m_sha256, l_digest.m_buffer.data());
+			break;
+		case HASH_SHA2_256:
+			sha256_final(&m_sha256, l_digest.m_buffer.data());
+			break;
+		case HASH_SHA2_384:
+			sha384_final(&m_sha512, l_digest.m_buffer.data());
+			break;
+		case HASH_SHA2_512:
+			sha512_final(&m_sha512, l_digest.m_buffer.data());
+			break;
+	}
 	l_digest.set_read_cursor(0);
 	l_digest.set_write_cursor(0);
+	reset();
 	return l_digest;
 }
 
-data data::sha2_512()
+data data::hash_file(const std::string& a_filename, hash_type a_type, std::size_t a_chunk)
+{
+	std::ifstream l_infile;
+	l_infile.open(a_filename.c_str(), std::ios::binary);
+	if (!l_infile.is_open()) {
+		data_exception e("hash_file: unable to open input file.");
+		throw(e);
+	}
+	hasher l_hasher(a_type);
+	std::vector<char> l_buff(std::max<std::size_t>(a_chunk, 1));
+	do {
+		l_infile.read(l_buff.data(), l_buff.size());
+		if (l_infile.bad()) {
+			data_exception e("hash_file: unable to read input file.");
+			throw(e);
+		}
+		l_hasher.update((std::uint8_t *)l_buff.data(), l_infile.gcount());
+	} while (!l_infile.eof());
+	return l_hasher.finish();
+}
+
+data::hmac_context::hmac_context(const data& a_key, hash_type a_type)
+: m_type(a_type)
+{
+	key(a_key.contents().data(), a_key.size());
+}
+
+data::hmac_context::hmac_context(const std::uint8_t *a_key, std::size_t a_key_len, hash_type a_type)
+: m_type(a_type)
+{
+	key(a_key, a_key_len);
+}
+
+void data::hmac_context::key(const std::uint8_t *a_key, std::size_t a_key_len)
+{
+	if ((m_type < HASH_SHA2_224) || (m_type > HASH_SHA2_512)) {
+		data_exception e("hmac_context: HMAC needs one of the SHA-2 hashes.");
+		throw(e);
+	}
+
+	// k0 the way hmac.c builds it: the key zero padded to the block length, or its digest if it's longer
+	std::size_t l_block = (m_type >= HASH_SHA2_384) ? 128 : 64;
+	std::array<std::uint8_t, 128> l_k0 = { };
+	if (a_key_len <= l_block) {
+		if (a_key_len > 0)
+			memcpy(l_k0.data(), a_key, a_key_len);
+	}
+	else {
+		hasher l_hasher(m_type);
+		l_hasher.update(a_key, a_key_len);
+		data l_digest = l_hasher.finish();
+		memcpy(l_k0.data(), l_digest.m_buffer.data(), l_digest.m_buffer.size());
+	}
+	std::array<std::uint8_t, 128> l_ipad, l_opad;
+	for (std::size_t i = 0; i < l_k0.size(); ++i) {
+		l_ipad[i] = l_k0[i] ^ 0x36;
+		l_opad[i] = l_k0[i] ^ 0x5c;
+	}
+
+	switch (m_type) {
+		case HASH_SHA2_224:
+			sha224_init(&m_sha256[KEYED_INNER]);
+			sha224_update(&m_sha256[KEYED_INNER], l_ipad.data(), l_block);
+			sha224_init(&m_sha256[KEYED_OUTER]);
+			sha224_update(&m_sha256[KEYED_OUTER], l_opad.data(), l_block);
+			break;
+		case HASH_SHA2_256:
+			sha256_init(&m_sha256[KEYED_INNER]);
+			sha256_update(&m_sha256[KEYED_INNER], l_ipad.data(), l_block);
+			sha256_init(&m_sha256[KEYED_OUTER]);
+			sha256_update(&m_sha256[KEYED_OUTER], l_opad.data(), l_block);
+			break;
+		case HASH_SHA2_384:
+			sha384_init(&m_sha512[KEYED_INNER]);
+			sha384_update(&m_sha512[KEYED_INNER], l_ipad.data(), l_block);
+			sha384_init(&m_sha512[KEYED_OUTER]);
+			sha384_update(&m_sha512[KEYED_OUTER], l_opad.data(), l_block);
+			break;
+		default:
+			sha512_init(&m_sha512[KEYED_INNER]);
+			sha512_update(&m_sha512[KEYED_INNER], l_ipad.data(), l_block);
+			sha512_init(&m_sha512[KEYED_OUTER]);
+			sha512_update(&m_sha512[KEYED_OUTER], l_opad.data(), l_block);
+			break;
+	}
+	reset();
+}
+
+void data::hmac_context::reset()
+{
+	if (m_type >= HASH_SHA2_384)
+		m_sha512[MESSAGE] = m_sha512[KEYED_INNER];
+	else
+		m_sha256[MESSAGE] = m_sha256[KEYED_INNER];
+}
+
+std::size_t data::hmac_context::digest_size() const
+{
+	const std::array<std::size_t, 4> l_sizes = { SHA224_DIGEST_SIZE, SHA256_DIGEST_SIZE, SHA384_DIGEST_SIZE, SHA512_DIGEST_SIZE };
+	return l_sizes[m_type - HASH_SHA2_224];
+}
+
+void data::hmac_context::update(const std::uint8_t *a_in, std::size_t a_len)
+{
+	// the C implementations take unsigned int lengths, so feed them at most 1GB at a time
+	const std::size_t l_max = 1 << 30;
+	while (a_len > 0) {
+		unsigned int l_len = std::min(a_len, l_max);
+		switch (m_type) {
+			case HASH_SHA2_224:
+				sha224_update(&m_sha256[MESSAGE], a_in, l_len);
+				break;
+			case HASH_SHA2_256:
+				sha256_update(&m_sha256[MESSAGE], a_in, l_len);
+				break;
+			case HASH_SHA2_384:
+				sha384_update(&m_sha512[MESSAGE], a_in, l_len);
+				break;
+			default:
+				sha512_update(&m_sha512[MESSAGE], a_in, l_len);
+				break;
+		}
+		a_in += l_len;
+		a_len -= l_len;
+	}
+}
+
+void data::hmac_context::finish(std::uint8_t *a_digest)
+{
+	// finish the inner hash, then hash it again from the keyed outer state
+	std::array<std::uint8_t, SHA512_DIGEST_SIZE> l_inner;
+	switch (m_type) {
+		case HASH_SHA2_224:
+			sha224_final(&m_sha256[MESSAGE], l_inner.data());
+			m_sha256[MESSAGE] = m_sha256[KEYED_OUTER];
+			sha224_update(&m_sha256[MESSAGE], l_inner.data(), SHA224_DIGEST_SIZE);
+			sha224_final(&m_sha256[MESSAGE], a_digest);
+			break;
+		case HASH_SHA2_256:
+			sha256_final(&m_sha256[MESSAGE], l_inner.data());
+			m_sha256[MESSAGE] = m_sha256[KEYED_OUTER];
+			sha256_update(&m_sha256[MESSAGE], l_inner.data(), SHA256_DIGEST_SIZE);
+			sha256_final(&m_sha256[MESSAGE], a_digest);
+			break;
+		case HASH_SHA2_384:
+			sha384_final(&m_sha512[MESSAGE], l_inner.data());
+			m_sha512[MESSAGE] = m_sha512[KEYED_OUTER];
+			sha384_update(&m_sha512[MESSAGE], l_inner.data(), SHA384_DIGEST_SIZE);
+			sha384_final(&m_sha512[MESSAGE], a_digest);
+			break;
+		default:
+			sha512_final(&m_sha512[MESSAGE], l_inner.data());
+			m_sha512[MESSAGE] = m_sha512[KEYED_OUTER];
+			sha512_update(&m_sha512[MESSAGE], l_inner.data(), SHA512_DIGEST_SIZE);
+			sha512_final(&m_sha512[MESSAGE], a_digest);
+			break;
+	}
+	reset();
+}
+
+data data::hmac_context::finish()
 {
 	data l_digest;
-	l_digest.fill(64, 0); // empty space to hold digest
-	sha512_ctx l_ctx;
-	sha512_init(&l_ctx);
-	sha512_update(&l_ctx, (const uint8_t *)m_buffer.data(), m_buffer.size());
-	sha512_final(&l_ctx, l_digest.m_buffer.data());
+	l_digest.fill(digest_size(), 0); // empty space to hold digest
+	finish(l_digest.m_buffer.data());
 	l_digest.set_read_cursor(0);
 	l_digest.set_write_cursor(0);
 	return l_digest;
 }
 
+data data::hmac_context::mac(const data& a_message) const
+{
+	hmac_context l_ctx(*this);
+	l_ctx.reset();
+	l_ctx.update(a_message);
+	return l_ctx.finish();
+}
+
+data data::hmac(const data& a_key, const data& a_message, hash_type a_type)
+{
+	hmac_context l_ctx(a_key, a_type);
+	l_ctx.update(a_message);
+	return l_ctx.finish();
+}
+
+std::vector<data> data::sha2_256_batch(const std::vector<data>& a_messages)
+{
+	sha256_ctx l_init;
+	sha256_init(&l_init);
+	std::vector<data> l_ret(a_messages.size());
+	std::vector<SHA256MB_job> l_jobs(a_messages.size());
+	for (std::size_t i = 0; i < a_messages.size(); ++i) {
+		l_ret[i].m_buffer.resize(32);
+		memcpy(l_jobs[i].h, l_init.h, sizeof(l_jobs[i].h));
+		l_jobs[i].prefix_len = 0;
+		l_jobs[i].msg = a_messages[i].contents().data();
+		l_jobs[i].len = a_messages[i].size();
+		l_jobs[i].digest = l_ret[i].m_buffer.data();
+	}
+	SHA256MB_run(l_jobs.data(), l_jobs.size(), SHA256MB_best());
+	return l_ret;
+}
+
+std::vector<data> data::hmac_sha2_256_batch(const data& a_key, const std::vector<data>& a_messages)
+{
+	return hmac_sha2_256_batch(hmac_context(a_key, HASH_SHA2_256), a_messages);
+}
+
+std::vector<data> data::hmac_sha2_256_batch(const hmac_context& a_key, const std::vector<data>& a_messages)
+{
+	if (a_key.type() != HASH_SHA2_256) {
+		data_exception e("hmac_sha2_256_batch: Context is not HMAC-SHA256.");
+		throw(e);
+	}
+	const sha256_ctx& l_inner = a_key.m_sha256[hmac_context::KEYED_INNER];
+	const sha256_ctx& l_outer = a_key.m_sha256[hmac_context::KEYED_OUTER];
+
+	// inner hashes of every message first, then the outer hashes over those
+	std::vector<data> l_ret(a_messages.size());
+	std::vector<std::uint8_t> l_inner_digests(a_messages.size() * 32);
+	std::vector<SHA256MB_job> l_jobs(a_messages.size());
+	for (std::size_t i = 0; i < a_messages.size(); ++i) {
+		memcpy(l_jobs[i].h, l_inner.h, sizeof(l_jobs[i].h));
+		l_jobs[i].prefix_len = 64;
+		l_jobs[i].msg = a_messages[i].contents().data();
+		l_jobs[i].len = a_messages[i].size();
+		l_jobs[i].digest = l_inner_digests.data() + i * 32;
+	}
+	SHA256MB_run(l_jobs.data(), l_jobs.size(), SHA256MB_best());
+	for (std::size_t i = 0; i < a_messages.size(); ++i) {
+		l_ret[i].m_buffer.resize(32);
+		memcpy(l_jobs[i].h, l_outer.h, sizeof(l_jobs[i].h));
+		l_jobs[i].msg = l_inner_digests.data() + i * 32;
+		l_jobs[i].len = 32;
+		l_jobs[i].digest = l_ret[i].m_buffer.data();
+	}
+	SHA256MB_run(l_jobs.data(), l_jobs.size(), SHA256MB_best());
+	return l_ret;
+}
+
 /* encryption: Blowfish and it's variants */
 
 data data::bf_key_random()
@@ -1525,6 +2244,7 @@ data data::bf7_key_schedule(const std::string& a_string)
 	data l_hash5 = l_hash4.sha2_512();
 	data l_hash6 = l_hash5.sha2_512();
 	data l_hash7 = l_hash6.sha2_512();
+	l_hash1.reserve(7 * 64);
 	l_hash1 += l_hash2;
 	l_hash1 += l_hash3;
 	l_hash1 += l_hash4;
@@ -1581,7 +2301,9 @@ data data::bf_block_encrypt(data& a_block, data& a_key)
 		data_exception e("Blowfish key must be between 8 and 56 bytes in length.");
 		throw (e);
 	}
-	ss::bf::block l_work(a_block.m_buffer.data(), a_key.m_buffer.data(), a_key.size());
+	std::array<std::uint8_t, 56> l_key;
+	std::ranges::copy(a_key.contents(), l_key.begin());
+	ss::bf::block l_work(a_block.contents().data(), l_key.data(), a_key.size());
 	l_work.encrypt();
 	data l_ret;
 	const std::uint8_t *blockdata = l_work.get_blockdata();
@@ -1597,87 +2319,10 @@ data data::bf7_block_encrypt(data& a_block, data& a_key)
 		data_exception e("Blowfish7 block must be 16 bytes in length.");
 		throw (e);
 	}
-	if (a_key.size() != 392) {
-		data_exception e("Blowfish7 key must be exactly 392 bytes in length.");
-		throw (e);
-	}
-	
-	// divide key into 7 keys
-	std::vector<data> keys;
-	ss::data l_empty;
-	a_key.set_read_cursor(0);
-	for (std::size_t i = 0; i < 7; ++i) {
-		keys.push_back(l_empty);
-		for (std::size_t j = 0; j < 56; ++j) {
-			keys[i].write_uint8(a_key.read_uint8());
-		}
-	}
-	
-	// debug: print our partial keys
-//	for (std::size_t i = 0; i < 7; ++i) {
-//		std::cout << std::format("partial key {}: {}", i + 1, keys[i].as_hex_str_nospace()) << std::endl;
-//	}
-	
-	std::array<std::uint8_t, 20> l_work;
-//	auto show_work = [&]() {
-//		std::cout << "work buffer: ";
-//		for (std::size_t i = 0; i < 20; ++i) {
-//			std::cout << std::hex << std::setfill('0') << std::setw(2) << (int)l_work[i];
-//			if (i == 15)
-//				std::cout << "-";
-//		}
-//		std::cout << std::endl;
-//	};
-	
-	memcpy(l_work.data(), a_block.buffer(), 16);
-	// wrap around first four bytes on end
-	memcpy(l_work.data() + 16, a_block.buffer(), 4);
-//	show_work();
-	
-	ss::bf::block block1((std::uint8_t *)l_work.data(), keys[0].buffer(), 56);
-	block1.encrypt();
-	memcpy(l_work.data(), block1.get_blockdata(), 8);
-	memcpy(l_work.data() + 16, l_work.data(), 4);
-//	show_work();
-	
-	ss::bf::block block2((std::uint8_t *)l_work.data() + 4, keys[1].buffer(), 56);
-	block2.encrypt();
-	memcpy(l_work.data() + 4, block2.get_blockdata(), 8);
-//	show_work();
-	
-	ss::bf::block block3((std::uint8_t *)l_work.data() + 8, keys[2].buffer(), 56);
-	block3.encrypt();
-	memcpy(l_work.data() + 8, block3.get_blockdata(), 8);
-//	show_work();
-	
-	ss::bf::block block4((std::uint8_t *)l_work.data() + 12, keys[3].buffer(), 56);
-	block4.encrypt();
-	memcpy(l_work.data() + 12, block4.get_blockdata(), 8);
-	memcpy(l_work.data(), l_work.data() + 16, 4);
-//	show_work();
-	
-	ss::bf::block block5((std::uint8_t *)l_work.data(), keys[4].buffer(), 56);
-	block5.decrypt();
-	memcpy(l_work.data(), block5.get_blockdata(), 8);
-//	show_work();
 	
-	ss::bf::block block6((std::uint8_t *)l_work.data() + 8, keys[5].buffer(), 56);
-	block6.decrypt();
-	memcpy(l_work.data() + 8, block6.get_blockdata(), 8);
-//	show_work();
-	
-	ss::bf::block block7a((std::uint8_t *)l_work.data(), keys[6].buffer(), 56);
-	ss::bf::block block7b((std::uint8_t *)l_work.data() + 8, keys[6].buffer(), 56);
-	block7a.encrypt();
-	block7b.encrypt();
-	memcpy(l_work.data(), block7a.get_blockdata(), 8);
-	memcpy(l_work.data() + 8, block7b.get_blockdata(), 8);
-//	show_work();
-	
-	data l_ret;
-	for (std::size_t i = 0; i < 16; ++i) {
-		l_ret.write_uint8(l_work[i]);
-	}
+	data l_ret = a_block;
+	bf7_context l_ctx(a_key);
+	l_ctx.encrypt_block(l_ret.buffer());
 	return l_ret;
 }
 
@@ -1692,7 +2337,9 @@ data data::bf_block_decrypt(data& a_block, data& a_key)
 		data_exception e("Blowfish key must be between 8 and 56 bytes in length.");
 		throw (e);
 	}
-	ss::bf::block l_work(a_block.m_buffer.data(), a_key.m_buffer.data(), a_key.size());
+	std::array<std::uint8_t, 56> l_key;
+	std::ranges::copy(a_key.contents(), l_key.begin());
+	ss::bf::block l_work(a_block.contents().data(), l_key.data(), a_key.size());
 	l_work.decrypt();
 	data l_ret;
 	const std::uint8_t *blockdata = l_work.get_blockdata();
@@ -1708,292 +2355,294 @@ data data::bf7_block_decrypt(data& a_block, data& a_key)
 		data_exception e("Blowfish7 block must be 16 bytes in length.");
 		throw (e);
 	}
-	if (a_key.size() != 392) {
-		data_exception e("Blowfish7 key must be exactly 392 bytes in length.");
-		throw (e);
-	}
 	
-	// divide key into 7 keys
-	std::vector<data> keys;
-	ss::data l_empty;
-	a_key.set_read_cursor(0);
-	for (std::size_t i = 0; i < 7; ++i) {
-		keys.push_back(l_empty);
-		for (std::size_t j = 0; j < 56; ++j) {
-			keys[i].write_uint8(a_key.read_uint8());
-		}
+	data l_ret = a_block;
+	bf7_context l_ctx(a_key);
+	l_ctx.decrypt_block(l_ret.buffer());
+	return l_ret;
+}
+
+// defined with the range coder further down; a_threads 0 means one per core
+static void range_run_segments(std::size_t a_seg_count, std::function<void(std::size_t)> a_job, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb, std::size_t a_threads = 0);
+
+const std::size_t m_cbc_chunk = 1048576; // threaded CBC decryption and counter mode hand out pieces this size
+const std::size_t m_cbc_threaded = 4 * m_cbc_chunk; // smaller buffers stay on the calling thread
+
+// how many threads to CBC decrypt or counter mode a_len bytes with, given the caller's a_threads (0 for one per core)
+static std::size_t cipher_threads(std::size_t a_len, std::size_t a_threads)
+{
+	if (a_len < m_cbc_threaded)
+		return 1;
+	return a_threads ? a_threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Every CBC plaintext block depends only on two ciphertext blocks, so a_buf can be cut into pieces and decrypted
+// in place on a_threads threads. a_piece(buf, len, iv) decrypts one piece; its iv is the ciphertext block in
+// front of it, saved before anything is overwritten.
+static void cbc_decrypt_pieces(std::uint8_t *a_buf, std::size_t a_len, std::size_t a_block, const std::uint8_t *a_iv, std::size_t a_threads, const std::function<void(std::uint8_t *, std::size_t, const std::uint8_t *)>& a_piece)
+{
+	std::size_t l_pieces = (a_len + m_cbc_chunk - 1) / m_cbc_chunk;
+	std::vector<std::uint8_t> l_ivs(l_pieces * a_block);
+	memcpy(l_ivs.data(), a_iv, a_block);
+	for (std::size_t l_piece = 1; l_piece < l_pieces; ++l_piece)
+		memcpy(l_ivs.data() + l_piece * a_block, a_buf + l_piece * m_cbc_chunk - a_block, a_block);
+	range_run_segments(l_pieces, [&](std::size_t l_piece) {
+		std::size_t l_offset = l_piece * m_cbc_chunk;
+		a_piece(a_buf + l_offset, std::min(m_cbc_chunk, a_len - l_offset), l_ivs.data() + l_piece * a_block);
+	}, [](std::uint64_t, std::uint64_t) { }, a_threads);
+}
+
+// run a_bf's CBC mode over whole 8 byte blocks of a_buf in place; a_bf carries the chaining value from one call to the next
+static void bf_cbc_encrypt(ss::bf::block& a_bf, std::uint8_t *a_buf, std::size_t a_len)
+{
+	for (std::size_t l_pos = 0; l_pos < a_len; l_pos += 8) {
+		a_bf.set_blockdata(a_buf + l_pos);
+		a_bf.encrypt_with_cbc();
+		memcpy(a_buf + l_pos, a_bf.get_blockdata(), 8);
 	}
-	
-	// debug: print our partial keys
-//	for (std::size_t i = 0; i < 7; ++i) {
-//		std::cout << std::format("partial key {}: {}", i + 1, keys[i].as_hex_str_nospace()) << std::endl;
-//	}
-//	
-	std::array<std::uint8_t, 20> l_work;
-//	auto show_work = [&]() {
-//		std::cout << "work buffer: ";
-//		for (std::size_t i = 0; i < 20; ++i) {
-//			std::cout << std::hex << std::setfill('0') << std::setw(2) << (int)l_work[i];
-//			if (i == 15)
-//				std::cout << "-";
-//		}
-//		std::cout << std::endl;
-//	};
-	
-	memcpy(l_work.data(), a_block.buffer(), 16);
-	memset(l_work.data() + 16, 0, 4);
-//	show_work();
-	
-	ss::bf::block block7a((std::uint8_t *)l_work.data(), keys[6].buffer(), 56);
-	ss::bf::block block7b((std::uint8_t *)l_work.data() + 8, keys[6].buffer(), 56);
-	block7a.decrypt();
-	block7b.decrypt();
-	memcpy(l_work.data(), block7a.get_blockdata(), 8);
-	memcpy(l_work.data() + 8, block7b.get_blockdata(), 8);
-//	show_work();
-	
-	ss::bf::block block6((std::uint8_t *)l_work.data() + 8, keys[5].buffer(), 56);
-	block6.encrypt();
-	memcpy(l_work.data() + 8, block6.get_blockdata(), 8);
-//	show_work();
-	
-	ss::bf::block block5((std::uint8_t *)l_work.data(), keys[4].buffer(), 56);
-	block5.encrypt();
-	memcpy(l_work.data(), block5.get_blockdata(), 8);
-	memcpy(l_work.data() + 16, l_work.data(), 4);
-//	show_work();
-	
-	ss::bf::block block4((std::uint8_t *)l_work.data() + 12, keys[3].buffer(), 56);
-	block4.decrypt();
-	memcpy(l_work.data() + 12, block4.get_blockdata(), 8);
-	memcpy(l_work.data(), l_work.data() + 16, 4);
-//	show_work();
-	
-	ss::bf::block block3((std::uint8_t *)l_work.data() + 8, keys[2].buffer(), 56);
-	block3.decrypt();
-	memcpy(l_work.data() + 8, block3.get_blockdata(), 8);
-//	show_work();
-	
-	ss::bf::block block2((std::uint8_t *)l_work.data() + 4, keys[1].buffer(), 56);
-	block2.decrypt();
-	memcpy(l_work.data() + 4, block2.get_blockdata(), 8);
-//	show_work();
-	
-	ss::bf::block block1((std::uint8_t *)l_work.data(), keys[0].buffer(), 56);
-	block1.decrypt();
-	memcpy(l_work.data(), block1.get_blockdata(), 8);
-//	show_work();
-	
-	data l_ret;
-	for (std::size_t i = 0; i < 16; ++i) {
-		l_ret.write_uint8(l_work[i]);
+}
+
+static void bf_cbc_decrypt(ss::bf::block& a_bf, std::uint8_t *a_buf, std::size_t a_len)
+{
+	for (std::size_t l_pos = 0; l_pos < a_len; l_pos += 8) {
+		a_bf.set_blockdata(a_buf + l_pos);
+		a_bf.decrypt_with_cbc();
+		memcpy(a_buf + l_pos, a_bf.get_blockdata(), 8);
 	}
-	return l_ret;
 }
 
 data data::bf_encrypt_with_cbc(data& a_data, data& a_key, data& a_iv)
+{
+	// the last block is zero padded out to 8 bytes
+	data l_ret;
+	l_ret.m_buffer.resize((a_data.size() + 7) & ~(std::size_t)7);
+	std::ranges::copy(a_data.contents(), l_ret.m_buffer.begin());
+	bf_encrypt_with_cbc(std::span<std::uint8_t>(l_ret.m_buffer), a_key, a_iv);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+void data::bf_encrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv)
+{
+	a_data.no_circular_mode("bf_encrypt_with_cbc_in_place");
+	a_data.m_buffer.resize((a_data.size() + 7) & ~(std::size_t)7);
+	bf_encrypt_with_cbc(std::span<std::uint8_t>(a_data.m_buffer), a_key, a_iv);
+	a_data.m_read_cursor = 0;
+	a_data.m_write_cursor = a_data.m_buffer.size();
+}
+
+void data::bf_encrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv)
 {
 	// sanity check IV
 	if (a_iv.size() != 8) {
 		throw data_exception("initialization vector needs to be same as block size.");
 	}
-	
-	data l_ret;
-	if (a_data.size() == 0) {
-		// just return empty buffer if we were passed zero length data
-		return l_ret;
+	if ((a_buf.size() % 8) != 0) {
+		throw data_exception("Input buffer must be justified on an 8 byte boundary.");
 	}
+	if (a_buf.empty())
+		return;
 	
-	ss::data l_block;
-	l_block.fill(8, 0);
-	ss::bf::block l_bf(l_block.buffer(), a_key.buffer(), a_key.size());
+	std::array<std::uint8_t, 8> l_empty = { };
+	ss::bf::block l_bf(l_empty.data(), a_key.buffer(), a_key.size());
 	l_bf.set_iv(a_iv.buffer());
-	std::size_t l_pos = 0;
-
-	auto block_clear = [&]() {
-		l_block.set_write_cursor(0);
-		for (std::size_t i = 0; i < 8; ++i)
-			l_block.write_uint8(0);
-		l_block.set_write_cursor(0);
-	};
-	
-	do {
-		std::size_t l_end = l_pos + 8;
-		l_end = (l_end > a_data.size() ? a_data.size() : l_end);
-//		std::cout << "reading from " << l_pos << " to one less than " << l_end << std::endl;
-		block_clear();
-		a_data.set_read_cursor(l_pos);
-		for (std::size_t i = l_pos; i < l_end; ++i) {
-			l_block.write_uint8(a_data.read_uint8());
-		}
-		l_bf.set_blockdata(l_block.buffer());
-		l_bf.encrypt_with_cbc();
-		block_clear();
-		l_block.assign(l_bf.get_blockdata(), 8);
-		l_ret += l_block;
-		l_pos += 8;
-	} while (l_pos < a_data.size());
-	
-	return l_ret;
+	bf_cbc_encrypt(l_bf, a_buf.data(), a_buf.size());
 }
 
 data data::bf7_encrypt_with_cbc(data& a_data, data& a_key, data& a_iv)
 {
-	// sanity check IV
-	if (a_iv.size() != 16) {
-		throw data_exception("initialization vector needs to be same as block size.");
-	}
-	
-	data l_ret;
-	if (a_data.size() == 0) {
-		// just return empty buffer if we were passed zero length data
-		return l_ret;
-	}
-	
-	data l_block;
-	data l_work_iv = a_iv;
-	std::size_t l_pos = 0;
+	bf7_context l_ctx(a_key);
+	return l_ctx.encrypt_cbc(a_data, a_iv);
+}
 
-	do {
-		std::size_t l_end = l_pos + 16;
-		l_end = (l_end > a_data.size() ? a_data.size() : l_end);
-//		std::cout << "reading from " << std::dec << l_pos << " to one less than " << l_end << std::endl;
-		a_data.set_read_cursor(l_pos);
-		l_block.clear();
-		l_block.fill(16, 0);
-		l_block.set_write_cursor(0);
-		for (std::size_t i = l_pos; i < l_end; ++i) {
-			l_block.write_uint8(a_data.read_uint8());
-		}
-//		std::cout << "iv is     " << l_work_iv.as_hex_str_nospace() << std::endl;
-		for (int i = 0; i < 16; ++i)
-			l_block[i] ^= l_work_iv[i];
-		data l_encblock = bf7_block_encrypt(l_block, a_key);
-		l_work_iv = l_encblock;
-//		std::cout << "iv is now " << l_work_iv.as_hex_str_nospace() << std::endl;
-		l_ret += l_encblock;
-		l_pos += 16;
-	} while (l_pos < a_data.size());
-	
+data data::bf_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	data l_ret;
+	std::span<const std::uint8_t> l_in = a_data.contents();
+	l_ret.m_buffer.assign(l_in.begin(), l_in.end());
+	bf_decrypt_with_cbc(std::span<std::uint8_t>(l_ret.m_buffer), a_key, a_iv, a_threads);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
 	return l_ret;
 }
 
-data data::bf_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv)
+void data::bf_decrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	a_data.no_circular_mode("bf_decrypt_with_cbc_in_place");
+	bf_decrypt_with_cbc(std::span<std::uint8_t>(a_data.m_buffer), a_key, a_iv, a_threads);
+	a_data.m_read_cursor = 0;
+	a_data.m_write_cursor = a_data.m_buffer.size();
+}
+
+void data::bf_decrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv, std::size_t a_threads)
 {
 	// sanity check IV
 	if (a_iv.size() != 8) {
 		throw data_exception("initialization vector needs to be same as block size.");
 	}
-	
-	data l_ret;
 	// bail out if the input buffer isn't a multiple of 8 bytes
-	if ((a_data.size() % 8) != 0) {
+	if ((a_buf.size() % 8) != 0) {
 		throw data_exception("Input buffer must be justified on an 8 byte boundary.");
 	}
+	if (a_buf.empty())
+		return;
 
-	ss::data l_block;
-	l_block.fill(8, 0);
-	ss::bf::block l_bf(l_block.buffer(), a_key.buffer(), a_key.size());
-	l_bf.set_iv(a_iv.buffer());
-	std::size_t l_pos = 0;
+	std::array<std::uint8_t, 8> l_empty = { };
+	ss::bf::block l_bf(l_empty.data(), a_key.buffer(), a_key.size());
+	std::size_t l_threads = cipher_threads(a_buf.size(), a_threads);
+	if (l_threads == 1) {
+		l_bf.set_iv(a_iv.buffer());
+		bf_cbc_decrypt(l_bf, a_buf.data(), a_buf.size());
+		return;
+	}
+	// the block carries the chaining value, so every piece works on its own copy
+	cbc_decrypt_pieces(a_buf.data(), a_buf.size(), 8, a_iv.buffer(), l_threads, [&](std::uint8_t *a_piece, std::size_t a_len, const std::uint8_t *a_piece_iv) {
+		ss::bf::block l_piece_bf = l_bf;
+		l_piece_bf.set_iv(a_piece_iv);
+		bf_cbc_decrypt(l_piece_bf, a_piece, a_len);
+	});
+}
 
-	auto block_clear = [&]() {
-		l_block.set_write_cursor(0);
-		for (std::size_t i = 0; i < 8; ++i)
-			l_block.write_uint8(0);
-		l_block.set_write_cursor(0);
-	};
-		
-	do {
-		block_clear();
-		a_data.set_read_cursor(l_pos);
-		for (std::size_t i = 0; i < 8; ++i) {
-			l_block.write_uint8(a_data.read_uint8());
-		}
-		l_bf.set_blockdata(l_block.buffer());
-		l_bf.decrypt_with_cbc();
-		block_clear();
-		l_block.assign(l_bf.get_blockdata(), 8);
-		l_ret += l_block;
-		l_pos += 8;
-	} while (l_pos < a_data.size());
-	
+data data::bf7_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	bf7_context l_ctx(a_key);
+	return l_ctx.decrypt_cbc(a_data, a_iv, a_threads);
+}
+
+void data::bf7_encrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv)
+{
+	bf7_context l_ctx(a_key);
+	l_ctx.encrypt_cbc_in_place(a_data, a_iv);
+}
+
+void data::bf7_decrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	bf7_context l_ctx(a_key);
+	l_ctx.decrypt_cbc_in_place(a_data, a_iv, a_threads);
+}
+
+void data::bf7_encrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv)
+{
+	bf7_context l_ctx(a_key);
+	l_ctx.encrypt_cbc(a_buf, a_iv);
+}
+
+void data::bf7_decrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	bf7_context l_ctx(a_key);
+	l_ctx.decrypt_cbc(a_buf, a_iv, a_threads);
+}
+
+const std::size_t m_cbc_hmac_chunk = 65536; // the CBC HMAC pipelines work through the buffer this much at a time
+
+data data::cbc_hmac_seal(const std::uint8_t *a_key, std::size_t a_key_len, const data& a_data, std::size_t a_block, const std::function<void(std::uint8_t *, std::size_t)>& a_cbc)
+{
+	// layout before encryption: hmac-sha256 of the plaintext, the plaintext, terminator byte, zero padding.
+	// Built straight into the output, which is the only allocation.
+	const std::uint8_t *l_in = a_data.contents().data();
+	std::size_t l_len = a_data.size();
+	data l_ret;
+	l_ret.m_buffer.resize((32 + l_len + 1 + a_block - 1) / a_block * a_block);
+	std::uint8_t *l_buf = l_ret.m_buffer.data();
+	std::size_t l_total = l_ret.m_buffer.size();
+
+	// the hmac goes in front of the plaintext, so it takes a read of its own before the first block can be encrypted
+	hmac_context l_hmac(a_key, a_key_len);
+	l_hmac.update(l_in, l_len);
+	l_hmac.finish(l_buf);
+	l_buf[32 + l_len] = 0x80;
+
+	// then copy and encrypt a chunk at a time while it's still in cache
+	for (std::size_t l_pos = 0; l_pos < l_total; l_pos += m_cbc_hmac_chunk) {
+		std::size_t l_end = std::min(l_pos + m_cbc_hmac_chunk, l_total);
+		std::size_t l_from = std::max(l_pos, (std::size_t)32);
+		std::size_t l_to = std::min(l_end, 32 + l_len);
+		if (l_from < l_to)
+			memcpy(l_buf + l_from, l_in + l_from - 32, l_to - l_from);
+		a_cbc(l_buf + l_pos, l_end - l_pos);
+	}
+	l_ret.m_write_cursor = l_total;
 	return l_ret;
 }
 
-data data::bf7_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv)
+data data::cbc_hmac_open(const std::uint8_t *a_key, std::size_t a_key_len, const data& a_data, std::size_t a_block, const std::function<void(std::uint8_t *, std::size_t)>& a_cbc, const std::string& a_cipher)
 {
-	// sanity check IV
-	if (a_iv.size() != 16) {
-		throw data_exception("initialization vector needs to be same as block size.");
+	// bail out if the input buffer isn't a multiple of the block size
+	std::size_t l_total = a_data.size();
+	if ((l_total % a_block) != 0) {
+		throw data_exception(std::string("Input buffer must be justified on ") + (a_block == 8 ? "an 8" : "a 16") + " byte boundary.");
 	}
-	
+
+	// each chunk is decrypted in scratch space and lands in its final place in the output, with everything but
+	// the last block (which holds the terminator) fed to the hmac on the way
+	const std::uint8_t *l_in = a_data.contents().data();
+	std::array<std::uint8_t, 32> l_saved;
+	std::vector<std::uint8_t> l_scratch(std::min(m_cbc_hmac_chunk, l_total));
 	data l_ret;
-	// bail out if the input buffer isn't a multiple of 8 bytes
-	if ((a_data.size() % 16) != 0) {
-		throw data_exception("Input buffer must be justified on a 16 byte boundary.");
+	l_ret.m_buffer.resize(l_total - 32);
+	std::uint8_t *l_out = l_ret.m_buffer.data();
+	std::size_t l_tail = l_total - a_block;
+	hmac_context l_hmac(a_key, a_key_len);
+	for (std::size_t l_pos = 0; l_pos < l_total; l_pos += m_cbc_hmac_chunk) {
+		std::size_t l_end = std::min(l_pos + m_cbc_hmac_chunk, l_total);
+		memcpy(l_scratch.data(), l_in + l_pos, l_end - l_pos);
+		a_cbc(l_scratch.data(), l_end - l_pos);
+		if (l_pos < 32)
+			memcpy(l_saved.data(), l_scratch.data(), 32);
+		std::size_t l_from = std::max(l_pos, (std::size_t)32);
+		memcpy(l_out + l_from - 32, l_scratch.data() + l_from - l_pos, l_end - l_from);
+		std::size_t l_to = std::min(l_end, l_tail);
+		if (l_from < l_to)
+			l_hmac.update(l_out + l_from - 32, l_to - l_from);
 	}
 
-	ss::data l_block;
-	data l_work_iv = a_iv;
-	std::size_t l_pos = 0;
-
+	// backtrack until we find the terminator byte
+	std::size_t l_decsize = l_ret.m_buffer.size();
 	do {
-		l_block.clear();
-		a_data.set_read_cursor(l_pos);
-		for (std::size_t i = 0; i < 16; ++i) {
-			l_block.write_uint8(a_data.read_uint8());
-		}
-		data l_save = l_block;
-		data l_decblock = bf7_block_decrypt(l_block, a_key);
-		for (int i = 0; i < 16; ++i)
-			l_decblock[i] ^= l_work_iv[i];
-		l_work_iv = l_save;
-		l_ret += l_decblock;
-		l_pos += 16;
-	} while (l_pos < a_data.size());
-	
+		if (l_decsize == 0) {
+			// searched the whole buffer, didn't find a terminator
+			throw data_exception(a_cipher + " CBC HMAC/SHA256 buffer must contain terminator byte.");
+		}
+		l_decsize--;
+	} while (l_out[l_decsize] != 0x80);
+
+	// make sure the saved hmac matches the computed hmac
+	std::array<std::uint8_t, 32> l_computed; // space for computed hmac
+	if (l_decsize + 32 >= l_tail) {
+		l_hmac.update(l_out + l_tail - 32, l_decsize + 32 - l_tail);
+		l_hmac.finish(l_computed.data());
+	} else {
+		// a stray 0x80 ahead of the last block, which a good buffer never has; start the hmac over
+		hmac_context l_whole(a_key, a_key_len);
+		l_whole.update(l_out, l_decsize);
+		l_whole.finish(l_computed.data());
+	}
+	if (memcmp(l_computed.data(), l_saved.data(), 32)) {
+		throw data_exception("HMAC mismatch error on decrypt. Possible data corruption.");
+	}
+	l_ret.m_buffer.resize(l_decsize);
+	l_ret.m_write_cursor = l_decsize;
 	return l_ret;
 }
 
 data data::encrypt_bf_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
 {
-	std::array<std::uint8_t, 32> l_hmac; // space to hold hmac-sha256
+	// sanity check IV
+	if (a_iv.size() != 8) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
 	
-	// compute the hmac on our plaintext and store it
-	hmacsha256(a_key.buffer(), a_key.size(), a_data.buffer(), a_data.size(), l_hmac.data());
-
-	// tack on terminator byte to our data
-	data l_withterm = a_data;
-	l_withterm.set_write_cursor_to_append();
-	l_withterm.write_uint8(0x80);
-
-	// create a new input buffer and seal the hmac value inside
-	data l_temp;
-	l_temp.assign(l_hmac.data(), 32);
-	l_temp += l_withterm;
-	data l_ret = data::bf_encrypt_with_cbc(l_temp, a_key, a_iv);
-	return l_ret;
+	std::array<std::uint8_t, 8> l_empty = { };
+	ss::bf::block l_bf(l_empty.data(), a_key.buffer(), a_key.size());
+	l_bf.set_iv(a_iv.buffer());
+	return cbc_hmac_seal(a_key.buffer(), a_key.size(), a_data, 8, [&](std::uint8_t *a_buf, std::size_t a_len) {
+		bf_cbc_encrypt(l_bf, a_buf, a_len);
+	});
 }
 
 data data::encrypt_bf7_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
 {
-	std::array<std::uint8_t, 32> l_hmac; // space to hold hmac-sha256
-	
-	// compute the hmac on our plaintext and store it
-	hmacsha256(a_key.buffer(), a_key.size(), a_data.buffer(), a_data.size(), l_hmac.data());
-
-	// tack on terminator byte to our data
-	data l_withterm = a_data;
-	l_withterm.set_write_cursor_to_append();
-	l_withterm.write_uint8(0x80);
-
-	// create a new input buffer and seal the hmac value inside
-	data l_temp;
-	l_temp.assign(l_hmac.data(), 32);
-	l_temp += l_withterm;
-	data l_ret = data::bf7_encrypt_with_cbc(l_temp, a_key, a_iv);
-	return l_ret;
+	bf7_context l_ctx(a_key);
+	return l_ctx.encrypt_cbc_hmac_sha2_256(a_data, a_iv);
 }
 
 data data::decrypt_bf_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
@@ -2003,87 +2652,282 @@ data data::decrypt_bf_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
 		// 32 byte hmac + at least one 8 byte block
 		throw data_exception("Blowfish CBC HMAC/SHA256 buffer must contain at least 40 bytes to decrypt.");
 	}
+	// sanity check IV
+	if (a_iv.size() != 8) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
 
-	std::array<std::uint8_t, 32> l_hmac; // space to hold hmac-sha256
-	std::array<std::uint8_t, 32> l_computed; // space for computed hmac
+	std::array<std::uint8_t, 8> l_empty = { };
+	ss::bf::block l_bf(l_empty.data(), a_key.buffer(), a_key.size());
+	l_bf.set_iv(a_iv.buffer());
+	return cbc_hmac_open(a_key.buffer(), a_key.size(), a_data, 8, [&](std::uint8_t *a_buf, std::size_t a_len) {
+		bf_cbc_decrypt(l_bf, a_buf, a_len);
+	}, "Blowfish");
+}
 
-	data l_dec = data::bf_decrypt_with_cbc(a_data, a_key, a_iv);
+data data::decrypt_bf7_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
+{
+	bf7_context l_ctx(a_key);
+	return l_ctx.decrypt_cbc_hmac_sha2_256(a_data, a_iv);
+}
+
+data::bf7_context::bf7_context(const data& a_key)
+{
+	if (a_key.size() != 392) {
+		data_exception e("Blowfish7 key must be exactly 392 bytes in length.");
+		throw (e);
+	}
+	std::ranges::copy(a_key.contents(), m_key.begin());
 	
-	// save bottom 32 bytes, which contain our hmac
-	l_dec.set_read_cursor(0);
-	for (auto& i : l_hmac)
-		i = l_dec.read_uint8();
-		
-	// move everything down by 32
-	l_dec.truncate_front(32);
+	// divide key into 7 keys of 56 bytes and schedule each one
+	std::array<std::uint8_t, 8> l_empty = { };
+	m_bf.reserve(7);
+	for (std::size_t i = 0; i < 7; ++i)
+		m_bf.emplace_back(l_empty.data(), m_key.data() + i * 56, 56);
+}
+
+void data::bf7_context::encrypt_sub(std::size_t a_key, std::uint8_t *a_half)
+{
+	m_bf[a_key].set_blockdata(a_half);
+	m_bf[a_key].encrypt();
+	memcpy(a_half, m_bf[a_key].get_blockdata(), 8);
+}
+
+void data::bf7_context::decrypt_sub(std::size_t a_key, std::uint8_t *a_half)
+{
+	m_bf[a_key].set_blockdata(a_half);
+	m_bf[a_key].decrypt();
+	memcpy(a_half, m_bf[a_key].get_blockdata(), 8);
+}
+
+void data::bf7_context::encrypt_block(std::uint8_t *a_block)
+{
+	std::array<std::uint8_t, 20> l_work;
 	
-	// backtrack until we find the terminator byte
-	std::int64_t l_decsize = l_dec.size();
-	bool l_found = false;
-	while (!l_found) {
-		l_decsize--;
-		if (l_decsize < 0) {
-			// searched the whole buffer, didn't find a terminator
-			throw data_exception("Blowfish CBC HMAC/SHA256 buffer must contain terminator byte.");
-		}
-		if (l_dec[l_decsize] == 0x80) {
-			l_dec.truncate_back(l_decsize);
-			l_found = true;
-		}
-	}
+	memcpy(l_work.data(), a_block, 16);
+	// wrap around first four bytes on end
+	memcpy(l_work.data() + 16, a_block, 4);
 	
-	// make sure the saved hmac matches the computed hmac
-//	std::cout << "key size " << a_key.size() << " l_dec.size " << l_dec.size() << std::endl;
-	hmacsha256(a_key.buffer(), a_key.size(), l_dec.buffer(), l_dec.size(), l_computed.data());
-	if (memcmp(l_computed.data(), l_hmac.data(), 32)) {
-		throw data_exception("HMAC mismatch error on decrypt. Possible data corruption.");
+	encrypt_sub(0, l_work.data());
+	memcpy(l_work.data() + 16, l_work.data(), 4);
+	encrypt_sub(1, l_work.data() + 4);
+	encrypt_sub(2, l_work.data() + 8);
+	encrypt_sub(3, l_work.data() + 12);
+	memcpy(l_work.data(), l_work.data() + 16, 4);
+	decrypt_sub(4, l_work.data());
+	decrypt_sub(5, l_work.data() + 8);
+	encrypt_sub(6, l_work.data());
+	encrypt_sub(6, l_work.data() + 8);
+	
+	memcpy(a_block, l_work.data(), 16);
+}
+
+void data::bf7_context::decrypt_block(std::uint8_t *a_block)
+{
+	std::array<std::uint8_t, 20> l_work;
+	
+	memcpy(l_work.data(), a_block, 16);
+	memset(l_work.data() + 16, 0, 4);
+	
+	decrypt_sub(6, l_work.data());
+	decrypt_sub(6, l_work.data() + 8);
+	encrypt_sub(5, l_work.data() + 8);
+	encrypt_sub(4, l_work.data());
+	memcpy(l_work.data() + 16, l_work.data(), 4);
+	decrypt_sub(3, l_work.data() + 12);
+	memcpy(l_work.data(), l_work.data() + 16, 4);
+	decrypt_sub(2, l_work.data() + 8);
+	decrypt_sub(1, l_work.data() + 4);
+	decrypt_sub(0, l_work.data());
+	
+	memcpy(a_block, l_work.data(), 16);
+}
+
+void data::bf7_context::cbc_encrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv)
+{
+	const std::uint8_t *l_iv = a_iv;
+	for (std::size_t l_pos = 0; l_pos < a_len; l_pos += 16) {
+		for (std::size_t i = 0; i < 16; ++i)
+			a_buf[l_pos + i] ^= l_iv[i];
+		encrypt_block(a_buf + l_pos);
+		l_iv = a_buf + l_pos;
 	}
-	return l_dec;
 }
 
-data data::decrypt_bf7_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
+void data::bf7_context::cbc_decrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv)
+{
+	std::array<std::uint8_t, 16> l_iv, l_save;
+	memcpy(l_iv.data(), a_iv, 16);
+	for (std::size_t l_pos = 0; l_pos < a_len; l_pos += 16) {
+		memcpy(l_save.data(), a_buf + l_pos, 16);
+		decrypt_block(a_buf + l_pos);
+		for (std::size_t i = 0; i < 16; ++i)
+			a_buf[l_pos + i] ^= l_iv[i];
+		l_iv = l_save;
+	}
+}
+
+data data::bf7_context::encrypt_cbc(const data& a_data, const data& a_iv)
+{
+	// the last block is zero padded out to 16 bytes
+	data l_ret;
+	l_ret.m_buffer.resize((a_data.size() + 15) & ~(std::size_t)15);
+	std::ranges::copy(a_data.contents(), l_ret.m_buffer.begin());
+	encrypt_cbc(std::span<std::uint8_t>(l_ret.m_buffer), a_iv);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+data data::bf7_context::decrypt_cbc(const data& a_data, const data& a_iv, std::size_t a_threads)
+{
+	data l_ret;
+	std::span<const std::uint8_t> l_in = a_data.contents();
+	l_ret.m_buffer.assign(l_in.begin(), l_in.end());
+	decrypt_cbc(std::span<std::uint8_t>(l_ret.m_buffer), a_iv, a_threads);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+void data::bf7_context::encrypt_cbc_in_place(data& a_data, const data& a_iv)
+{
+	a_data.no_circular_mode("bf7_context::encrypt_cbc_in_place");
+	a_data.m_buffer.resize((a_data.size() + 15) & ~(std::size_t)15);
+	encrypt_cbc(std::span<std::uint8_t>(a_data.m_buffer), a_iv);
+	a_data.m_read_cursor = 0;
+	a_data.m_write_cursor = a_data.m_buffer.size();
+}
+
+void data::bf7_context::decrypt_cbc_in_place(data& a_data, const data& a_iv, std::size_t a_threads)
+{
+	a_data.no_circular_mode("bf7_context::decrypt_cbc_in_place");
+	decrypt_cbc(std::span<std::uint8_t>(a_data.m_buffer), a_iv, a_threads);
+	a_data.m_read_cursor = 0;
+	a_data.m_write_cursor = a_data.m_buffer.size();
+}
+
+void data::bf7_context::encrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv)
+{
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
+	if ((a_buf.size() % 16) != 0) {
+		throw data_exception("Input buffer must be justified on a 16 byte boundary.");
+	}
+	cbc_encrypt(a_buf.data(), a_buf.size(), a_iv.contents().data());
+}
+
+void data::bf7_context::decrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv, std::size_t a_threads)
+{
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
+	// bail out if the input buffer isn't a multiple of 16 bytes
+	if ((a_buf.size() % 16) != 0) {
+		throw data_exception("Input buffer must be justified on a 16 byte boundary.");
+	}
+	std::size_t l_threads = cipher_threads(a_buf.size(), a_threads);
+	if (l_threads == 1) {
+		cbc_decrypt(a_buf.data(), a_buf.size(), a_iv.contents().data());
+		return;
+	}
+	// the sub-key blocks hold per-call state, so every piece works on its own copy of the context
+	cbc_decrypt_pieces(a_buf.data(), a_buf.size(), 16, a_iv.contents().data(), l_threads, [&](std::uint8_t *a_piece, std::size_t a_len, const std::uint8_t *a_piece_iv) {
+		bf7_context l_piece_ctx(*this);
+		l_piece_ctx.cbc_decrypt(a_piece, a_len, a_piece_iv);
+	});
+}
+
+data data::bf7_context::encrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv)
+{
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
+	std::array<std::uint8_t, 16> l_iv;
+	std::ranges::copy(a_iv.contents(), l_iv.begin());
+	return cbc_hmac_seal(m_key.data(), m_key.size(), a_data, 16, [&](std::uint8_t *a_buf, std::size_t a_len) {
+		cbc_encrypt(a_buf, a_len, l_iv.data());
+		memcpy(l_iv.data(), a_buf + a_len - 16, 16);
+	});
+}
+
+data data::bf7_context::decrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv)
 {
 	// sanity check m_input_buffer_len
 	if (a_data.size() < 48) {
 		// 32 byte hmac + at least one 16 byte block
 		throw data_exception("Blowfish7 CBC HMAC/SHA256 buffer must contain at least 48 bytes to decrypt.");
 	}
-
-	std::array<std::uint8_t, 32> l_hmac; // space to hold hmac-sha256
-	std::array<std::uint8_t, 32> l_computed; // space for computed hmac
-
-	data l_dec = data::bf7_decrypt_with_cbc(a_data, a_key, a_iv);
-
-	// save bottom 32 bytes, which contain our hmac
-	l_dec.set_read_cursor(0);
-	for (auto& i : l_hmac)
-		i = l_dec.read_uint8();
-		
-	// move everything down by 32
-	l_dec.truncate_front(32);
-	
-	// backtrack until we find the terminator byte
-	std::int64_t l_decsize = l_dec.size();
-	bool l_found = false;
-	while (!l_found) {
-		l_decsize--;
-		if (l_decsize < 0) {
-			// searched the whole buffer, didn't find a terminator
-			throw data_exception("Blowfish7 CBC HMAC/SHA256 buffer must contain terminator byte.");
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
+	std::array<std::uint8_t, 16> l_iv, l_next;
+	std::ranges::copy(a_iv.contents(), l_iv.begin());
+	return cbc_hmac_open(m_key.data(), m_key.size(), a_data, 16, [&](std::uint8_t *a_buf, std::size_t a_len) {
+		memcpy(l_next.data(), a_buf + a_len - 16, 16);
+		cbc_decrypt(a_buf, a_len, l_iv.data());
+		l_iv = l_next;
+	}, "Blowfish7");
+}
+
+// Blowfish7 contexts and IVs for the little secret functions, most recently used first. Deriving them takes
+// eight SHA-2 hashes and seven Blowfish key schedules, which dwarfs decoding a short secret.
+class little_secret_cache {
+public:
+	struct keys {
+		keys(const std::string& a_passphrase) : m_ctx(data::bf7_key_schedule(a_passphrase)), m_iv(data::bf7_iv_schedule(a_passphrase)) { }
+		data::bf7_context m_ctx;
+		data m_iv;
+	};
+	static little_secret_cache& get()
+	{
+		static little_secret_cache l_cache;
+		return l_cache;
+	}
+	std::shared_ptr<const keys> find(const std::string& a_passphrase)
+	{
+		data l_work;
+		l_work.write_std_str(a_passphrase);
+		data l_id = l_work.sha2_256();
+		{
+			std::lock_guard<std::mutex> l_guard(m_mutex);
+			for (auto l_it = m_entries.begin(); l_it != m_entries.end(); ++l_it) {
+				if (l_it->first == l_id) {
+					m_entries.splice(m_entries.begin(), m_entries, l_it);
+					return l_it->second;
+				}
+			}
 		}
-		if (l_dec[l_decsize] == 0x80) {
-			l_dec.truncate_back(l_decsize);
-			l_found = true;
+		// derive without holding the lock; two threads missing on the same passphrase both derive, and the
+		// second insert just drops the oldest entry a little early
+		std::shared_ptr<const keys> l_keys = std::make_shared<const keys>(a_passphrase);
+		std::lock_guard<std::mutex> l_guard(m_mutex);
+		if (m_capacity > 0) {
+			m_entries.emplace_front(l_id, l_keys);
+			if (m_entries.size() > m_capacity)
+				m_entries.pop_back();
 		}
-	}
-	
-	// make sure the saved hmac matches the computed hmac
-//	std::cout << "key size " << a_key.size() << " l_dec.size " << l_dec.size() << std::endl;
-	hmacsha256(a_key.buffer(), a_key.size(), l_dec.buffer(), l_dec.size(), l_computed.data());
-	if (memcmp(l_computed.data(), l_hmac.data(), 32)) {
-		throw data_exception("HMAC mismatch error on decrypt. Possible data corruption.");
-	}
-	return l_dec;
+		return l_keys;
+	}
+	void capacity(std::size_t a_entries)
+	{
+		std::lock_guard<std::mutex> l_guard(m_mutex);
+		m_capacity = a_entries;
+		while (m_entries.size() > m_capacity)
+			m_entries.pop_back();
+	}
+protected:
+	std::mutex m_mutex;
+	std::size_t m_capacity = data::LITTLE_SECRET_CACHE_ENTRIES;
+	std::list<std::pair<data, std::shared_ptr<const keys> > > m_entries;
+};
+
+void data::little_secret_cache_size(std::size_t a_entries)
+{
+	little_secret_cache::get().capacity(a_entries);
 }
 
 std::string data::encode_little_secret(const std::string& a_passphrase, const std::string& a_message)
@@ -2091,9 +2935,9 @@ std::string data::encode_little_secret(const std::string& a_passphrase, const st
 	try {
 		data l_message;
 		l_message.write_std_str(a_message);
-		data l_key = bf7_key_schedule(a_passphrase);
-		data l_iv = bf7_iv_schedule(a_passphrase);
-		data l_enc = encrypt_bf7_cbc_hmac_sha2_256(l_message, l_key, l_iv);
+		std::shared_ptr<const little_secret_cache::keys> l_keys = little_secret_cache::get().find(a_passphrase);
+		bf7_context l_ctx(l_keys->m_ctx); // contexts aren't shared between threads, so work on a copy
+		data l_enc = l_ctx.encrypt_cbc_hmac_sha2_256(l_message, l_keys->m_iv);
 		data l_bracket;
 		l_bracket.write_std_str("a[");
 		l_bracket.write_std_str(l_enc.as_base64());
@@ -2105,7 +2949,8 @@ std::string data::encode_little_secret(const std::string& a_passphrase, const st
 	}
 }
 
-std::string data::decode_little_secret(const std::string& a_passphrase, const std::string& a_message)
+// decode one little secret with keys already derived from the passphrase
+static std::string decode_little_secret_with(data::bf7_context& a_ctx, const data& a_iv, const std::string& a_message)
 {
 	try {
 		std::string l_bracket = a_message;
@@ -2122,9 +2967,7 @@ std::string data::decode_little_secret(const std::string& a_passphrase, const st
 		l_bracket.erase(0, 2);
 		data l_enc;
 		l_enc.write_base64(l_bracket);
-		data l_key = bf7_key_schedule(a_passphrase);
-		data l_iv = bf7_iv_schedule(a_passphrase);
-		data l_dec = decrypt_bf7_cbc_hmac_sha2_256(l_enc, l_key, l_iv);
+		data l_dec = a_ctx.decrypt_cbc_hmac_sha2_256(l_enc, a_iv);
 		std::string l_ret = l_dec.read_std_str(l_dec.size());
 		return l_ret;
 	} catch (std::exception& e) {
@@ -2132,6 +2975,26 @@ std::string data::decode_little_secret(const std::string& a_passphrase, const st
 	}
 }
 
+std::string data::decode_little_secret(const std::string& a_passphrase, const std::string& a_message)
+{
+	return decode_little_secrets(a_passphrase, std::vector<std::string>(1, a_message))[0];
+}
+
+std::vector<std::string> data::decode_little_secrets(const std::string& a_passphrase, const std::vector<std::string>& a_messages)
+{
+	std::vector<std::string> l_ret;
+	l_ret.reserve(a_messages.size());
+	try {
+		std::shared_ptr<const little_secret_cache::keys> l_keys = little_secret_cache::get().find(a_passphrase);
+		bf7_context l_ctx(l_keys->m_ctx);
+		for (const std::string& l_message : a_messages)
+			l_ret.push_back(decode_little_secret_with(l_ctx, l_keys->m_iv, l_message));
+	} catch (std::exception& e) {
+		l_ret.assign(a_messages.size(), std::string("error (") + e.what() + std::string(")"));
+	}
+	return l_ret;
+}
+
 /* AES section */
  
 data data::aes256_key_random()
@@ -2172,17 +3035,10 @@ data data::aes256_block_encrypt(data& a_block, data& a_key)
 	if (a_block.size() != 16) {
 		throw data_exception("AES block must be 16 bytes in length.");
 	}
-	if (a_key.size() != 32) {
-		throw data_exception("AES256 key must be 32 bytes in length.");
-	}
 	
 	data l_block = a_block;
-//	std::cout << "starting with block " << l_block.as_hex_str_nospace() << std::endl;
-//	std::cout << "starting with key   " << a_key.as_hex_str_nospace() << std::endl;
-	struct AES_ctx ctx;
-	AES_init_ctx(&ctx, a_key.buffer());
-	AES_ECB_encrypt(&ctx, l_block.buffer());
-//	std::cout << "neding   with block " << l_block.as_hex_str_nospace() << std::endl;
+	aes256_context l_ctx(a_key);
+	l_ctx.encrypt_block(l_block.buffer());
 	return l_block;
 }
 
@@ -2192,165 +3048,430 @@ data data::aes256_block_decrypt(data& a_block, data& a_key)
 	if (a_block.size() != 16) {
 		throw data_exception("AES block must be 16 bytes in length.");
 	}
-	if (a_key.size() != 32) {
-		throw data_exception("AES256 key must be 32 bytes in length.");
-	}
 	
 	data l_block = a_block;
-//	std::cout << "starting with block " << l_block.as_hex_str_nospace() << std::endl;
-//	std::cout << "starting with key   " << a_key.as_hex_str_nospace() << std::endl;
-	struct AES_ctx ctx;
-	AES_init_ctx(&ctx, a_key.buffer());
-	AES_ECB_decrypt(&ctx, l_block.buffer());
-//	std::cout << "neding   with block " << l_block.as_hex_str_nospace() << std::endl;
+	aes256_context l_ctx(a_key);
+	l_ctx.decrypt_block(l_block.buffer());
 	return l_block;
 }
 
 data data::aes256_encrypt_with_cbc(data& a_data, data& a_key, data& a_iv)
 {
-	// sanity check IV
-	if (a_iv.size() != 16) {
-		throw data_exception("AES initialization vector needs to be same as block size.");
-	}
-	
-	data l_ret;
-	if (a_data.size() == 0) {
-		// just return empty buffer if we were passed zero length data
-		return l_ret;
-	}
-	
-	data l_block;
-	data l_work_iv = a_iv;
-	std::size_t l_pos = 0;
+	aes256_context l_ctx(a_key);
+	return l_ctx.encrypt_cbc(a_data, a_iv);
+}
 
-	do {
-		std::size_t l_end = l_pos + 16;
-		l_end = (l_end > a_data.size() ? a_data.size() : l_end);
-//		std::cout << "reading from " << std::dec << l_pos << " to one less than " << l_end << std::endl;
-		a_data.set_read_cursor(l_pos);
-		l_block.clear();
-		l_block.fill(16, 0);
-		l_block.set_write_cursor(0);
-		for (std::size_t i = l_pos; i < l_end; ++i) {
-			l_block.write_uint8(a_data.read_uint8());
-		}
-//		std::cout << "iv is     " << l_work_iv.as_hex_str_nospace() << std::endl;
-		for (int i = 0; i < 16; ++i)
-			l_block[i] ^= l_work_iv[i];
-		data l_encblock = aes256_block_encrypt(l_block, a_key);
-		l_work_iv = l_encblock;
-//		std::cout << "iv is now " << l_work_iv.as_hex_str_nospace() << std::endl;
-		l_ret += l_encblock;
-		l_pos += 16;
-	} while (l_pos < a_data.size());
-	
-	return l_ret;
+data data::aes256_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	aes256_context l_ctx(a_key);
+	return l_ctx.decrypt_cbc(a_data, a_iv, a_threads);
 }
 
-data data::aes256_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv)
+void data::aes256_encrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv)
 {
-	// sanity check IV
-	if (a_iv.size() != 16) {
-		throw data_exception("initialization vector needs to be same as block size.");
-	}
-	
-	data l_ret;
-	// bail out if the input buffer isn't a multiple of 8 bytes
-	if ((a_data.size() % 16) != 0) {
-		throw data_exception("Input buffer must be justified on a 16 byte boundary.");
-	}
+	aes256_context l_ctx(a_key);
+	l_ctx.encrypt_cbc_in_place(a_data, a_iv);
+}
 
-	ss::data l_block;
-	data l_work_iv = a_iv;
-	std::size_t l_pos = 0;
+void data::aes256_decrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	aes256_context l_ctx(a_key);
+	l_ctx.decrypt_cbc_in_place(a_data, a_iv, a_threads);
+}
 
-	do {
-		l_block.clear();
-		a_data.set_read_cursor(l_pos);
-		for (std::size_t i = 0; i < 16; ++i) {
-			l_block.write_uint8(a_data.read_uint8());
-		}
-		data l_save = l_block;
-		data l_decblock = aes256_block_decrypt(l_block, a_key);
-		for (int i = 0; i < 16; ++i)
-			l_decblock[i] ^= l_work_iv[i];
-		l_work_iv = l_save;
-		l_ret += l_decblock;
-		l_pos += 16;
-	} while (l_pos < a_data.size());
-	
-	return l_ret;
+void data::aes256_encrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv)
+{
+	aes256_context l_ctx(a_key);
+	l_ctx.encrypt_cbc(a_buf, a_iv);
+}
+
+void data::aes256_decrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	aes256_context l_ctx(a_key);
+	l_ctx.decrypt_cbc(a_buf, a_iv, a_threads);
 }
 
 data data::encrypt_aes256_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
 {
-	std::array<std::uint8_t, 32> l_hmac; // space to hold hmac-sha256
-	
-	// compute the hmac on our plaintext and store it
-	hmacsha256(a_key.buffer(), a_key.size(), a_data.buffer(), a_data.size(), l_hmac.data());
-
-	// tack on terminator byte to our data
-	data l_withterm = a_data;
-	l_withterm.set_write_cursor_to_append();
-	l_withterm.write_uint8(0x80);
-
-	// create a new input buffer and seal the hmac value inside
-	data l_temp;
-	l_temp.assign(l_hmac.data(), 32);
-	l_temp += l_withterm;
-	data l_ret = data::aes256_encrypt_with_cbc(l_temp, a_key, a_iv);
-	return l_ret;
+	aes256_context l_ctx(a_key);
+	return l_ctx.encrypt_cbc_hmac_sha2_256(a_data, a_iv);
 }
 
 data data::decrypt_aes256_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv)
 {
-	// sanity check m_input_buffer_len
-	if (a_data.size() < 48) {
-		// 32 byte hmac + at least one 16 byte block
-		throw data_exception("AES256 CBC HMAC/SHA256 buffer must contain at least 48 bytes to decrypt.");
-	}
+	aes256_context l_ctx(a_key);
+	return l_ctx.decrypt_cbc_hmac_sha2_256(a_data, a_iv);
+}
 
-	std::array<std::uint8_t, 32> l_hmac; // space to hold hmac-sha256
-	std::array<std::uint8_t, 32> l_computed; // space for computed hmac
+data data::aes256_ctr(data& a_data, data& a_key, data& a_iv, std::size_t a_threads)
+{
+	aes256_context l_ctx(a_key);
+	return l_ctx.ctr(a_data, a_iv, a_threads);
+}
 
-	data l_dec = data::aes256_decrypt_with_cbc(a_data, a_key, a_iv);
+data data::aes256_gcm_iv_random()
+{
+	data l_ret;
+	l_ret.random(12); // random 96 bit gcm iv
+	return l_ret;
+}
 
-	// save bottom 32 bytes, which contain our hmac
-	l_dec.set_read_cursor(0);
-	for (auto& i : l_hmac)
-		i = l_dec.read_uint8();
-		
-	// move everything down by 32
-	l_dec.truncate_front(32);
-	
-	// backtrack until we find the terminator byte
-	std::int64_t l_decsize = l_dec.size();
-	bool l_found = false;
-	while (!l_found) {
-		l_decsize--;
-		if (l_decsize < 0) {
-			// searched the whole buffer, didn't find a terminator
-			throw data_exception("AES256 CBC HMAC/SHA256 buffer must contain terminator byte.");
+data data::encrypt_aes256_gcm(data& a_data, data& a_key, data& a_iv, const data& a_aad, std::size_t a_threads)
+{
+	aes256_context l_ctx(a_key);
+	return l_ctx.encrypt_gcm(a_data, a_iv, a_aad, a_threads);
+}
+
+data data::decrypt_aes256_gcm(data& a_data, data& a_key, data& a_iv, const data& a_aad, std::size_t a_threads)
+{
+	aes256_context l_ctx(a_key);
+	return l_ctx.decrypt_gcm(a_data, a_iv, a_aad, a_threads);
+}
+
+const std::uint64_t m_gcm_max_len = (1ULL << 36) - 32; // GCM's limit of 2^32 - 2 blocks per message
+
+// add a_blocks to the 128 bit big endian counter block a_ctr. GCM only increments the low 32 bits, but its
+// messages are limited so that never carries out of them (see m_gcm_max_len), and the two agree.
+static void ctr_add(std::array<std::uint8_t, 16>& a_ctr, std::uint64_t a_blocks)
+{
+	for (int i = 15; (i >= 0) && (a_blocks > 0); --i) {
+		std::uint64_t l_sum = a_ctr[i] + (a_blocks & 0xff);
+		a_ctr[i] = l_sum & 0xff;
+		a_blocks = (a_blocks >> 8) + (l_sum >> 8);
+	}
+}
+
+// GHASH multiply, one bit at a time, for CPUs without PCLMULQDQ: a_y = a_y * a_h in GF(2^128)
+static void ghash_multiply(std::array<std::uint8_t, 16>& a_y, const std::array<std::uint8_t, 16>& a_h)
+{
+	std::uint64_t l_vh = 0, l_vl = 0, l_zh = 0, l_zl = 0;
+	for (std::size_t i = 0; i < 8; ++i) {
+		l_vh = (l_vh << 8) | a_h[i];
+		l_vl = (l_vl << 8) | a_h[i + 8];
+	}
+	for (std::size_t i = 0; i < 128; ++i) {
+		if (a_y[i / 8] & (0x80 >> (i % 8))) {
+			l_zh ^= l_vh;
+			l_zl ^= l_vl;
+		}
+		bool l_lsb = l_vl & 1;
+		l_vl = (l_vl >> 1) | (l_vh << 63);
+		l_vh >>= 1;
+		if (l_lsb)
+			l_vh ^= 0xe100000000000000ULL;
+	}
+	for (std::size_t i = 0; i < 8; ++i) {
+		a_y[i] = l_zh >> (56 - i * 8);
+		a_y[i + 8] = l_zl >> (56 - i * 8);
+	}
+}
+
+data::aes256_context::aes256_context(const data& a_key, bool a_hardware)
+{
+	if (a_key.size() != 32) {
+		throw data_exception("AES256 key must be 32 bytes in length.");
+	}
+	std::ranges::copy(a_key.contents(), m_key.begin());
+	static const bool l_aesni_available = AESNI_available();
+	m_aesni = a_hardware && l_aesni_available;
+	if (m_aesni)
+		AESNI_init_ctx(&m_ni, m_key.data());
+	else
+		AES_init_ctx(&m_ctx, m_key.data());
+	m_h.fill(0);
+	encrypt_block(m_h.data());
+}
+
+void data::aes256_context::cbc_encrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv) const
+{
+	if (m_aesni) {
+		AESNI_CBC_encrypt(&m_ni, a_buf, a_len, a_iv);
+		return;
+	}
+	const std::uint8_t *l_iv = a_iv;
+	for (std::size_t l_pos = 0; l_pos < a_len; l_pos += 16) {
+		for (std::size_t i = 0; i < 16; ++i)
+			a_buf[l_pos + i] ^= l_iv[i];
+		encrypt_block(a_buf + l_pos);
+		l_iv = a_buf + l_pos;
+	}
+}
+
+void data::aes256_context::cbc_decrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv) const
+{
+	if (m_aesni) {
+		AESNI_CBC_decrypt(&m_ni, a_buf, a_len, a_iv);
+		return;
+	}
+	std::array<std::uint8_t, 16> l_iv, l_save;
+	memcpy(l_iv.data(), a_iv, 16);
+	for (std::size_t l_pos = 0; l_pos < a_len; l_pos += 16) {
+		memcpy(l_save.data(), a_buf + l_pos, 16);
+		decrypt_block(a_buf + l_pos);
+		for (std::size_t i = 0; i < 16; ++i)
+			a_buf[l_pos + i] ^= l_iv[i];
+		l_iv = l_save;
+	}
+}
+
+data data::aes256_context::encrypt_cbc(const data& a_data, const data& a_iv) const
+{
+	// the last block is zero padded out to 16 bytes
+	data l_ret;
+	l_ret.m_buffer.resize((a_data.size() + 15) & ~(std::size_t)15);
+	std::ranges::copy(a_data.contents(), l_ret.m_buffer.begin());
+	encrypt_cbc(std::span<std::uint8_t>(l_ret.m_buffer), a_iv);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+data data::aes256_context::decrypt_cbc(const data& a_data, const data& a_iv, std::size_t a_threads) const
+{
+	data l_ret;
+	std::span<const std::uint8_t> l_in = a_data.contents();
+	l_ret.m_buffer.assign(l_in.begin(), l_in.end());
+	decrypt_cbc(std::span<std::uint8_t>(l_ret.m_buffer), a_iv, a_threads);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+void data::aes256_context::encrypt_cbc_in_place(data& a_data, const data& a_iv) const
+{
+	a_data.no_circular_mode("aes256_context::encrypt_cbc_in_place");
+	a_data.m_buffer.resize((a_data.size() + 15) & ~(std::size_t)15);
+	encrypt_cbc(std::span<std::uint8_t>(a_data.m_buffer), a_iv);
+	a_data.m_read_cursor = 0;
+	a_data.m_write_cursor = a_data.m_buffer.size();
+}
+
+void data::aes256_context::decrypt_cbc_in_place(data& a_data, const data& a_iv, std::size_t a_threads) const
+{
+	a_data.no_circular_mode("aes256_context::decrypt_cbc_in_place");
+	decrypt_cbc(std::span<std::uint8_t>(a_data.m_buffer), a_iv, a_threads);
+	a_data.m_read_cursor = 0;
+	a_data.m_write_cursor = a_data.m_buffer.size();
+}
+
+void data::aes256_context::encrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv) const
+{
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("AES initialization vector needs to be same as block size.");
+	}
+	if ((a_buf.size() % 16) != 0) {
+		throw data_exception("Input buffer must be justified on a 16 byte boundary.");
+	}
+	cbc_encrypt(a_buf.data(), a_buf.size(), a_iv.contents().data());
+}
+
+void data::aes256_context::decrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv, std::size_t a_threads) const
+{
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
+	// bail out if the input buffer isn't a multiple of 16 bytes
+	if ((a_buf.size() % 16) != 0) {
+		throw data_exception("Input buffer must be justified on a 16 byte boundary.");
+	}
+	std::size_t l_threads = cipher_threads(a_buf.size(), a_threads);
+	if (l_threads == 1) {
+		cbc_decrypt(a_buf.data(), a_buf.size(), a_iv.contents().data());
+		return;
+	}
+	cbc_decrypt_pieces(a_buf.data(), a_buf.size(), 16, a_iv.contents().data(), l_threads, [&](std::uint8_t *a_piece, std::size_t a_len, const std::uint8_t *a_piece_iv) {
+		cbc_decrypt(a_piece, a_len, a_piece_iv);
+	});
+}
+
+data data::aes256_context::encrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv) const
+{
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("AES initialization vector needs to be same as block size.");
+	}
+	std::array<std::uint8_t, 16> l_iv;
+	std::ranges::copy(a_iv.contents(), l_iv.begin());
+	return cbc_hmac_seal(m_key.data(), m_key.size(), a_data, 16, [&](std::uint8_t *a_buf, std::size_t a_len) {
+		cbc_encrypt(a_buf, a_len, l_iv.data());
+		memcpy(l_iv.data(), a_buf + a_len - 16, 16);
+	});
+}
+
+data data::aes256_context::decrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv) const
+{
+	// sanity check m_input_buffer_len
+	if (a_data.size() < 48) {
+		// 32 byte hmac + at least one 16 byte block
+		throw data_exception("AES256 CBC HMAC/SHA256 buffer must contain at least 48 bytes to decrypt.");
+	}
+	// sanity check IV
+	if (a_iv.size() != 16) {
+		throw data_exception("initialization vector needs to be same as block size.");
+	}
+	std::array<std::uint8_t, 16> l_iv, l_next;
+	std::ranges::copy(a_iv.contents(), l_iv.begin());
+	return cbc_hmac_open(m_key.data(), m_key.size(), a_data, 16, [&](std::uint8_t *a_buf, std::size_t a_len) {
+		memcpy(l_next.data(), a_buf + a_len - 16, 16);
+		cbc_decrypt(a_buf, a_len, l_iv.data());
+		l_iv = l_next;
+	}, "AES256");
+}
+
+void data::aes256_context::ctr_xor(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_ctr, std::size_t a_threads) const
+{
+	std::array<std::uint8_t, 16> l_start;
+	memcpy(l_start.data(), a_ctr, 16);
+	auto run = [&](std::uint8_t *a_piece, std::size_t a_piece_len, std::array<std::uint8_t, 16> a_piece_ctr) {
+		if (m_aesni) {
+			AESNI_CTR_xor(&m_ni, a_piece, a_piece_len, a_piece_ctr.data());
+			return;
 		}
-		if (l_dec[l_decsize] == 0x80) {
-			l_dec.truncate_back(l_decsize);
-			l_found = true;
+		std::array<std::uint8_t, 16> l_ks;
+		for (std::size_t l_pos = 0; l_pos < a_piece_len; l_pos += 16) {
+			l_ks = a_piece_ctr;
+			encrypt_block(l_ks.data());
+			for (std::size_t i = 0; (i < 16) && (l_pos + i < a_piece_len); ++i)
+				a_piece[l_pos + i] ^= l_ks[i];
+			ctr_add(a_piece_ctr, 1);
 		}
+	};
+	std::size_t l_threads = cipher_threads(a_len, a_threads);
+	if (l_threads <= 1) {
+		run(a_buf, a_len, l_start);
+		return;
 	}
-	
-	// make sure the saved hmac matches the computed hmac
-//	std::cout << "key size " << a_key.size() << " l_dec.size " << l_dec.size() << std::endl;
-	hmacsha256(a_key.buffer(), a_key.size(), l_dec.buffer(), l_dec.size(), l_computed.data());
-	if (memcmp(l_computed.data(), l_hmac.data(), 32)) {
-		throw data_exception("HMAC mismatch error on decrypt. Possible data corruption.");
+	// every piece knows its starting counter, so they can all run at once
+	std::size_t l_pieces = (a_len + m_cbc_chunk - 1) / m_cbc_chunk;
+	range_run_segments(l_pieces, [&](std::size_t l_piece) {
+		std::array<std::uint8_t, 16> l_piece_ctr = l_start;
+		ctr_add(l_piece_ctr, l_piece * (m_cbc_chunk / 16));
+		std::size_t l_offset = l_piece * m_cbc_chunk;
+		run(a_buf + l_offset, std::min(m_cbc_chunk, a_len - l_offset), l_piece_ctr);
+	}, [](std::uint64_t, std::uint64_t) { }, l_threads);
+}
+
+void data::aes256_context::ghash(std::array<std::uint8_t, 16>& a_y, const std::uint8_t *a_buf, std::size_t a_len) const
+{
+	static const bool l_clmul_available = AESNI_GHASH_available();
+	std::size_t l_whole = a_len & ~(std::size_t)15;
+	if (m_aesni && l_clmul_available) {
+		AESNI_GHASH(m_h.data(), a_y.data(), a_buf, l_whole);
+	} else {
+		for (std::size_t l_pos = 0; l_pos < l_whole; l_pos += 16) {
+			for (std::size_t i = 0; i < 16; ++i)
+				a_y[i] ^= a_buf[l_pos + i];
+			ghash_multiply(a_y, m_h);
+		}
 	}
-	return l_dec;
+	if (l_whole < a_len) {
+		std::array<std::uint8_t, 16> l_last = { };
+		memcpy(l_last.data(), a_buf + l_whole, a_len - l_whole);
+		ghash(a_y, l_last.data(), 16);
+	}
+}
+
+std::array<std::uint8_t, 16> data::aes256_context::gcm_tag(const std::uint8_t *a_iv, const data& a_aad, const std::uint8_t *a_ct, std::size_t a_len) const
+{
+	std::array<std::uint8_t, 16> l_y = { };
+	ghash(l_y, a_aad.contents().data(), a_aad.size());
+	ghash(l_y, a_ct, a_len);
+	std::array<std::uint8_t, 16> l_lens;
+	std::uint64_t l_aad_bits = std::byteswap((std::uint64_t)a_aad.size() * 8);
+	std::uint64_t l_ct_bits = std::byteswap((std::uint64_t)a_len * 8);
+	if (std::endian::native == std::endian::big) {
+		l_aad_bits = std::byteswap(l_aad_bits);
+		l_ct_bits = std::byteswap(l_ct_bits);
+	}
+	memcpy(l_lens.data(), &l_aad_bits, 8);
+	memcpy(l_lens.data() + 8, &l_ct_bits, 8);
+	ghash(l_y, l_lens.data(), 16);
+
+	// tag is GHASH xored with the encryption of counter block J0 = IV || 1
+	std::array<std::uint8_t, 16> l_j0 = { };
+	memcpy(l_j0.data(), a_iv, 12);
+	l_j0[15] = 1;
+	encrypt_block(l_j0.data());
+	for (std::size_t i = 0; i < 16; ++i)
+		l_y[i] ^= l_j0[i];
+	return l_y;
+}
+
+data data::aes256_context::ctr(const data& a_data, const data& a_iv, std::size_t a_threads) const
+{
+	if (a_iv.size() != 16) {
+		throw data_exception("AES CTR initial counter block must be 16 bytes in length.");
+	}
+	data l_ret;
+	std::span<const std::uint8_t> l_in = a_data.contents();
+	l_ret.m_buffer.assign(l_in.begin(), l_in.end());
+	ctr_xor(l_ret.m_buffer.data(), l_ret.m_buffer.size(), a_iv.contents().data(), a_threads);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+data data::aes256_context::encrypt_gcm(const data& a_data, const data& a_iv, const data& a_aad, std::size_t a_threads) const
+{
+	if (a_iv.size() != 12) {
+		throw data_exception("AES GCM initialization vector must be 12 bytes in length.");
+	}
+	if (a_data.size() > m_gcm_max_len) {
+		throw data_exception("AES GCM message is too long.");
+	}
+	data l_ret;
+	l_ret.m_buffer.resize(a_data.size() + 16);
+	std::ranges::copy(a_data.contents(), l_ret.m_buffer.begin());
+	// payload counter blocks start at J0 + 1
+	std::array<std::uint8_t, 16> l_ctr = { };
+	memcpy(l_ctr.data(), a_iv.contents().data(), 12);
+	l_ctr[15] = 2;
+	ctr_xor(l_ret.m_buffer.data(), a_data.size(), l_ctr.data(), a_threads);
+	std::array<std::uint8_t, 16> l_tag = gcm_tag(a_iv.contents().data(), a_aad, l_ret.m_buffer.data(), a_data.size());
+	std::copy(l_tag.begin(), l_tag.end(), l_ret.m_buffer.begin() + a_data.size());
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+data data::aes256_context::decrypt_gcm(const data& a_data, const data& a_iv, const data& a_aad, std::size_t a_threads) const
+{
+	if (a_iv.size() != 12) {
+		throw data_exception("AES GCM initialization vector must be 12 bytes in length.");
+	}
+	if (a_data.size() < 16) {
+		throw data_exception("AES GCM buffer must contain at least the 16 byte tag.");
+	}
+	std::size_t l_len = a_data.size() - 16;
+	if (l_len > m_gcm_max_len) {
+		throw data_exception("AES GCM message is too long.");
+	}
+	// check the tag before decrypting anything, without bailing out at the first difference
+	std::array<std::uint8_t, 16> l_tag = gcm_tag(a_iv.contents().data(), a_aad, a_data.contents().data(), l_len);
+	std::uint8_t l_diff = 0;
+	for (std::size_t i = 0; i < 16; ++i)
+		l_diff |= l_tag[i] ^ a_data.contents()[l_len + i];
+	if (l_diff != 0) {
+		throw data_exception("GCM tag mismatch error on decrypt. Possible data corruption.");
+	}
+	data l_ret;
+	std::span<const std::uint8_t> l_in = a_data.contents();
+	l_ret.m_buffer.assign(l_in.begin(), l_in.begin() + l_len);
+	std::array<std::uint8_t, 16> l_ctr = { };
+	memcpy(l_ctr.data(), a_iv.contents().data(), 12);
+	l_ctr[15] = 2;
+	ctr_xor(l_ret.m_buffer.data(), l_len, l_ctr.data(), a_threads);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
 }
 
 /* compression */
 	
-data data::huffman_encode() const
+data data::huffman_encode(bool a_canonical) const
 {
+	if (a_canonical)
+		return huffman_encode_canonical();
+
+	std::span<const std::uint8_t> l_src = contents();
+
 	std::deque<huff_tree_node> l_in;
 	std::vector<huff_tree_node> l_out;
 	std::int16_t l_out_root = -1;
@@ -2359,20 +3480,20 @@ data data::huffman_encode() const
 
 	// check for zero length edge case
 	// just write a magic cookie with zero length
-	if (m_buffer.size() == 0) {
+	if (l_src.size() == 0) {
 		data l_encoded;
 		bit_cursor l_write_bit_cursor;
 		l_encoded.set_write_bit_cursor(l_write_bit_cursor);
 		l_encoded.write_bits(HUFF_MAGIC_COOKIE, 32);
-		l_encoded.write_bits(static_cast<std::uint64_t>(m_buffer.size()), 64);
+		l_encoded.write_bits(static_cast<std::uint64_t>(l_src.size()), 64);
 		return l_encoded;
 	}
 	
 	// populate frequency table
 	for (std::uint64_t i = 0; i < 256; ++i)
 		l_freq[i] = 0;
-	for (std::size_t i = 0; i < m_buffer.size(); ++i)
-		++l_freq[m_buffer[i]];
+	for (std::size_t i = 0; i < l_src.size(); ++i)
+		++l_freq[l_src[i]];
 
 	// make a node for each symbol with >0 frequency
 	for (std::uint64_t i = 0; i < 256; ++i) {
@@ -2556,74 +3677,79 @@ data data::huffman_encode() const
 	// Write out m_buffer contents to another ss::data object, substiuting the bytes for the huffman codes in l_codes.
 
 	data l_encoded;
-	bit_cursor l_write_bit_cursor;
-	l_encoded.set_write_bit_cursor(l_write_bit_cursor);
+	{
+		bit_writer l_writer(l_encoded);
+
+		// find the next greater power of 2 of l_max_freq.
+		// there is an easier way of doing this in c++23 using the <bit> library
+		// TODO: refactor this
+		if (m_huffman_debug) std::cout << "huffman_encode: l_max_freq=" << l_max_freq << std::endl;
+		std::int16_t l_maxbits = 64;
+		while ((l_max_freq & 0x8000000000000000ULL) == 0) {
+			l_max_freq <<= 1;
+			--l_maxbits;
+		}
+		if (m_huffman_debug) std::cout << "huffman_encode: frequency table width=" << l_maxbits << std::endl;
 
-	// find the next greater power of 2 of l_max_freq.
-	// there is an easier way of doing this in c++23 using the <bit> library
-	// TODO: refactor this
-	if (m_huffman_debug) std::cout << "huffman_encode: l_max_freq=" << l_max_freq << std::endl;
-	std::int16_t l_maxbits = 64;
-	while ((l_max_freq & 0x8000000000000000ULL) == 0) {
-		l_max_freq <<= 1;
-		--l_maxbits;
-	}
-	if (m_huffman_debug) std::cout << "huffman_encode: frequency table width=" << l_maxbits << std::endl;
+		// magic cookie
+		l_writer.write_bits(HUFF_MAGIC_COOKIE, 32);
 
-	// magic cookie
-	l_encoded.write_bits(HUFF_MAGIC_COOKIE, 32);
+		// 64 bit data length
+		l_writer.write_bits(static_cast<std::uint64_t>(l_src.size()), 64);
 
-	// 64 bit data length
-	l_encoded.write_bits(static_cast<std::uint64_t>(m_buffer.size()), 64);
+		// frequency table symbol width
+		l_writer.write_bits(l_maxbits, 6);
 
-	// frequency table symbol width
-	l_encoded.write_bits(l_maxbits, 6);
+		// frequency table
+		for (std::uint64_t i = 0; i < 256; ++i)
+			l_writer.write_bits(l_freq[i], l_maxbits);
 
-	// frequency table
-	for (std::uint64_t i = 0; i < 256; ++i)
-		l_encoded.write_bits(l_freq[i], l_maxbits);
+		// advance write cursor to next whole byte
+		l_writer.advance_to_next_whole_byte();
+		if (m_huffman_debug) std::cout << "huffman_encode: codes start at: (l_writer.get_bit_cursor().byte)=" << l_writer.get_bit_cursor().byte << std::endl;
 
-	// advance write cursor to next whole byte
-	l_encoded.m_write_bit_cursor.advance_to_next_whole_byte();
-	if (m_huffman_debug) std::cout << "huffman_encode: codes start at: (l_encoded.m_write_bit_cursor.byte)=" << l_encoded.m_write_bit_cursor.byte << std::endl;
+		// flatten the code map into a lookup table so the inner loop doesn't have to search it
+		std::array<std::pair<std::uint64_t, std::int16_t>, 256> l_code_table;
+		for (const auto& i : l_codes)
+			l_code_table[i.first] = i.second;
 
-	// write out huffman codes
-	for (std::size_t i = 0; i < m_buffer.size(); ++i) {
-		std::map<std::uint8_t, std::pair<std::uint64_t, std::int16_t> >::iterator l_it = l_codes.find(m_buffer[i]);
-		std::uint64_t l_bits = (l_it->second).first;
-		std::int16_t l_len = (l_it->second).second;
-		l_encoded.write_bits(l_bits, l_len);
+		// write out huffman codes
+		for (std::size_t i = 0; i < l_src.size(); ++i) {
+			const std::pair<std::uint64_t, std::int16_t>& l_code = l_code_table[l_src[i]];
+			l_writer.write_bits(l_code.first, l_code.second);
+		}
 	}
 	return l_encoded;
 }
 
 data data::huffman_decode() const
 {
-	data l_work = *this; // copy ourselves so we can maintain constness
-	l_work.m_read_bit_cursor.set_absolute(0);
+	bit_reader l_reader(*this); // reads from the top of the buffer without disturbing our cursors
 
 	// verify magic cookie
-	std::uint32_t l_cookie = l_work.read_bits(32);
+	std::uint32_t l_cookie = l_reader.read_bits(32);
+	if (l_cookie == HUFF_CANONICAL_MAGIC_COOKIE)
+		return huffman_decode_canonical();
 	if (l_cookie != HUFF_MAGIC_COOKIE) {
 		// if our magic cookie is missing, don't even bother to decode the buffer
 		data_exception e("huffman_decode: Magic cookie missing from buffer.");
 		throw (e);
 	}
 
-	std::uint64_t l_datalen = l_work.read_bits(64);
+	std::uint64_t l_datalen = l_reader.read_bits(64);
 	// if we read a 0 data length, just return an empty buffer
 	if (l_datalen == 0) {
 		data l_decoded;
 		return l_decoded;
 	}
 	
-	std::int16_t l_width = l_work.read_bits(6);
+	std::int16_t l_width = l_reader.read_bits(6);
 
 	if (m_huffman_debug) std::cout << "huffman_decode: l_datalen=" << l_datalen << " l_width=" << l_width << std::endl;
 
 	std::uint64_t l_freq[256];
 	for (std::uint64_t i = 0; i < 256; ++i)
-		l_freq[i] = l_work.read_bits(l_width);
+		l_freq[i] = l_reader.read_bits(l_width);
 
 	std::deque<huff_tree_node> l_in;
 	std::vector<huff_tree_node> l_out;
@@ -2697,8 +3823,8 @@ data data::huffman_decode() const
 	// to the symbol we're interested in.
 	data l_decoded;
 	l_decoded.m_write_bit_cursor.set_absolute(0);
-	l_work.m_read_bit_cursor.advance_to_next_whole_byte();
-	if (m_huffman_debug) std::cout << "huffman_decode: codes start at (m_read_bit_cursor.byte)=" << m_read_bit_cursor.byte << std::endl;
+	l_reader.advance_to_next_whole_byte();
+	if (m_huffman_debug) std::cout << "huffman_decode: codes start at (l_reader.get_bit_cursor().byte)=" << l_reader.get_bit_cursor().byte << std::endl;
 
 	for (std::uint64_t i = 0; i < l_datalen; ++i) {
 		std::uint8_t l_symbol;
@@ -2716,7 +3842,7 @@ data data::huffman_decode() const
 			}
 
 			// we're on an INTERNAL node, so traverse downwards
-			bool l_bit = l_work.read_bit();
+			bool l_bit = l_reader.read_bit();
 			if (l_bit) {
 				// 1 bit, head right
 				l_cur = l_apex.right_id;
@@ -2732,174 +3858,625 @@ data data::huffman_decode() const
 	return l_decoded;
 }	
 
-data data::rle_encode() const
+// Compute huffman code lengths for a frequency table, limited to a_max_len bits.
+// If the tree comes out too deep, the frequencies are flattened and the tree rebuilt.
+static void huffman_code_lengths(const std::uint64_t* a_freq, std::uint8_t* a_lengths, std::uint16_t a_max_len)
 {
-	std::uint8_t RLE_ESCAPE = 0x55;
-	const std::uint8_t RLE_INCREMENT = 0x3B;
-
-	data l_in = *this;
-	data l_out;
-	
-	// if we're empty, nothing to do
-	if (l_in.size() == 0)
-		return l_out;
+	std::uint64_t l_freq[256];
+	std::uint16_t l_symbols = 0;
+	for (std::uint16_t i = 0; i < 256; ++i) {
+		l_freq[i] = a_freq[i];
+		a_lengths[i] = 0;
+		if (l_freq[i] > 0)
+			++l_symbols;
+	}
+	if (l_symbols == 0)
+		return;
 
-	std::uint8_t l_new, l_old = 0, l_count = 0;
-	bool l_clear = true; // set this to indicate l_old is empty
+	// single symbol edge case, give it a one bit code
+	if (l_symbols == 1) {
+		for (std::uint16_t i = 0; i < 256; ++i)
+			if (l_freq[i] > 0)
+				a_lengths[i] = 1;
+		return;
+	}
 
-	// sliding window RLE
 	do {
-		l_new = l_in.read_uint8();
+		// leaves are nodes 0-255, internal nodes are numbered from 256 upwards in order of creation,
+		// so the root is always the last node made and every parent comes after its children
+		std::priority_queue<std::pair<std::uint64_t, std::uint16_t>, std::vector<std::pair<std::uint64_t, std::uint16_t> >, std::greater<std::pair<std::uint64_t, std::uint16_t> > > l_queue;
+		std::array<std::uint16_t, 512> l_parent;
+		std::uint16_t l_next = 256;
+		for (std::uint16_t i = 0; i < 256; ++i)
+			if (l_freq[i] > 0)
+				l_queue.push(std::make_pair(l_freq[i], i));
+		while (l_queue.size() > 1) {
+			std::pair<std::uint64_t, std::uint16_t> l_left = l_queue.top();
+			l_queue.pop();
+			std::pair<std::uint64_t, std::uint16_t> l_right = l_queue.top();
+			l_queue.pop();
+			l_parent[l_left.second] = l_next;
+			l_parent[l_right.second] = l_next;
+			l_queue.push(std::make_pair(l_left.first + l_right.first, l_next));
+			++l_next;
+		}
 
-		// did we encounter an escape? If so, flush the window then double it up, then rotate the escape
-		if (l_new == RLE_ESCAPE) {
-			if (!l_clear) {
-				if (l_count > 0) {
-					// if we've repeated fewer than 4 times, just write the bytes themselves
-					if (l_count < 3) {
-						for (std::uint64_t i = 0; i <= l_count; ++i)
-							l_out.write_uint8(l_old);
-						l_count = 0;
-					} else {
-						// write out compound set
-						l_out.write_uint8(RLE_ESCAPE);
-						l_out.write_uint8(l_old);
-						l_out.write_uint8(l_count + 1);
-						l_count = 0;
-					}
-				} else {
-					// weren't counting when we encountered escape, so just write out l_old
-					l_out.write_uint8(l_old);
-				}
+		// walk depths from the root downwards
+		std::array<std::uint16_t, 512> l_depth;
+		std::uint16_t l_root = l_next - 1;
+		l_depth[l_root] = 0;
+		for (std::int32_t i = l_root - 1; i >= 256; --i)
+			l_depth[i] = l_depth[l_parent[i]] + 1;
+		std::uint16_t l_max = 0;
+		for (std::uint16_t i = 0; i < 256; ++i) {
+			if (l_freq[i] > 0) {
+				l_depth[i] = l_depth[l_parent[i]] + 1;
+				if (l_depth[i] > l_max)
+					l_max = l_depth[i];
 			}
-			l_out.write_uint8(RLE_ESCAPE);
-			l_out.write_uint8(RLE_ESCAPE);
-			RLE_ESCAPE += RLE_INCREMENT;
-			l_clear = true;
-			continue;
+		}
+		if (l_max <= a_max_len) {
+			for (std::uint16_t i = 0; i < 256; ++i)
+				if (l_freq[i] > 0)
+					a_lengths[i] = l_depth[i];
+			return;
 		}
 
-		// first time through the loop (and after escapes), just stash away the first byte
-		if (l_clear) {
-			l_old = l_new;
-			l_clear = false;
+		// too deep, halve the frequencies (keeping them non-zero) and try again
+		for (std::uint16_t i = 0; i < 256; ++i)
+			if (l_freq[i] > 0)
+				l_freq[i] = (l_freq[i] + 1) >> 1;
+	} while (1);
+}
+
+data data::huffman_encode_canonical() const
+{
+	// Format: magic cookie, 64 bit data length, then a 5 bit code length for every character 0x00-0xff
+	// (0 meaning the character isn't used), pad to the next whole byte, then the codes.
+	// Codes are assigned canonically from the lengths, so the decoder doesn't need to rebuild the tree.
+	std::span<const std::uint8_t> l_src = contents();
+
+	// check for zero length edge case
+	// just write a magic cookie with zero length
+	if (l_src.size() == 0) {
+		data l_encoded;
+		l_encoded.write_bits(HUFF_CANONICAL_MAGIC_COOKIE, 32);
+		l_encoded.write_bits(static_cast<std::uint64_t>(l_src.size()), 64);
+		return l_encoded;
+	}
+
+	// populate frequency table
+	std::uint64_t l_freq[256];
+	for (std::uint64_t i = 0; i < 256; ++i)
+		l_freq[i] = 0;
+	for (std::size_t i = 0; i < l_src.size(); ++i)
+		++l_freq[l_src[i]];
+
+	std::uint8_t l_lengths[256];
+	huffman_code_lengths(l_freq, l_lengths, HUFF_MAX_CODE_LEN);
+
+	// assign codes in order of (length, symbol)
+	std::array<std::pair<std::uint64_t, std::int16_t>, 256> l_code_table;
+	std::uint64_t l_code = 0;
+	std::uint16_t l_prev_len = 0;
+	for (std::uint16_t l_len = 1; l_len <= HUFF_MAX_CODE_LEN; ++l_len) {
+		for (std::uint16_t i = 0; i < 256; ++i) {
+			if (l_lengths[i] == l_len) {
+				l_code <<= (l_len - l_prev_len);
+				l_prev_len = l_len;
+				l_code_table[i] = std::make_pair(l_code, l_len);
+				if (m_huffman_debug) std::cout << "huffman_encode: sym:" << std::hex << i << std::dec << " freq:" << l_freq[i] << " len:" << l_len << " code:" << l_code << std::endl;
+				++l_code;
+			}
+		}
+	}
+
+	data l_encoded;
+	{
+		bit_writer l_writer(l_encoded);
+		l_writer.write_bits(HUFF_CANONICAL_MAGIC_COOKIE, 32);
+		l_writer.write_bits(static_cast<std::uint64_t>(l_src.size()), 64);
+
+		// code length table
+		for (std::uint16_t i = 0; i < 256; ++i)
+			l_writer.write_bits(l_lengths[i], 5);
+
+		// advance write cursor to next whole byte
+		l_writer.advance_to_next_whole_byte();
+		if (m_huffman_debug) std::cout << "huffman_encode: codes start at: (l_writer.get_bit_cursor().byte)=" << l_writer.get_bit_cursor().byte << std::endl;
+
+		// write out huffman codes
+		for (std::size_t i = 0; i < l_src.size(); ++i) {
+			const std::pair<std::uint64_t, std::int16_t>& l_code = l_code_table[l_src[i]];
+			l_writer.write_bits(l_code.first, l_code.second);
+		}
+	}
+	return l_encoded;
+}
+
+data data::huffman_decode_canonical() const
+{
+	bit_reader l_reader(*this);
+	l_reader.skip_bits(32); // magic cookie, already checked by huffman_decode
+
+	std::uint64_t l_datalen = l_reader.read_bits(64);
+	data l_decoded;
+	if (l_datalen == 0)
+		return l_decoded;
+	// every code is at least one bit, so don't trust a length the buffer couldn't possibly hold
+	if (l_datalen > (size() << 3)) {
+		data_exception e("huffman_decode: Data length in buffer is invalid.");
+		throw (e);
+	}
+
+	// read the code lengths and count how many codes there are of each length
+	std::uint8_t l_lengths[256];
+	std::array<std::uint32_t, HUFF_MAX_CODE_LEN + 1> l_count = { };
+	for (std::uint16_t i = 0; i < 256; ++i) {
+		l_lengths[i] = l_reader.read_bits(5);
+		if (l_lengths[i] > HUFF_MAX_CODE_LEN) {
+			data_exception e("huffman_decode: Invalid code length in buffer.");
+			throw (e);
+		}
+		++l_count[l_lengths[i]];
+	}
+	l_count[0] = 0;
+
+	// first canonical code of each length, and where that length's symbols start in l_sorted.
+	// check on the way that the lengths don't describe more codes than can exist
+	std::array<std::uint64_t, HUFF_MAX_CODE_LEN + 1> l_first = { };
+	std::array<std::uint32_t, HUFF_MAX_CODE_LEN + 1> l_offset = { };
+	std::uint64_t l_code = 0;
+	std::uint32_t l_index = 0;
+	for (std::uint16_t l_len = 1; l_len <= HUFF_MAX_CODE_LEN; ++l_len) {
+		l_code <<= 1;
+		l_first[l_len] = l_code;
+		l_offset[l_len] = l_index;
+		l_code += l_count[l_len];
+		l_index += l_count[l_len];
+		if (l_code > (1ULL << l_len)) {
+			data_exception e("huffman_decode: Code lengths in buffer are invalid.");
+			throw (e);
+		}
+	}
+	if (l_index == 0) {
+		data_exception e("huffman_decode: No codes in buffer.");
+		throw (e);
+	}
+
+	// symbols in canonical order
+	std::array<std::uint8_t, 256> l_sorted;
+	std::array<std::uint32_t, HUFF_MAX_CODE_LEN + 1> l_fill = l_offset;
+	for (std::uint16_t i = 0; i < 256; ++i)
+		if (l_lengths[i] > 0)
+			l_sorted[l_fill[l_lengths[i]]++] = i;
+
+	// primary table, indexed by the next HUFF_TABLE_BITS bits of input. Each entry is (length << 8) | symbol,
+	// with 0 meaning the code is longer than the table and has to be resolved the slow way.
+	std::vector<std::uint16_t> l_table(1 << HUFF_TABLE_BITS, 0);
+	for (std::uint16_t l_len = 1; l_len <= HUFF_TABLE_BITS; ++l_len) {
+		for (std::uint32_t i = 0; i < l_count[l_len]; ++i) {
+			std::uint32_t l_start = (l_first[l_len] + i) << (HUFF_TABLE_BITS - l_len);
+			std::uint32_t l_span = 1 << (HUFF_TABLE_BITS - l_len);
+			std::uint16_t l_entry = (l_len << 8) | l_sorted[l_offset[l_len] + i];
+			for (std::uint32_t j = 0; j < l_span; ++j)
+				l_table[l_start + j] = l_entry;
+		}
+	}
+
+	l_reader.advance_to_next_whole_byte();
+	if (m_huffman_debug) std::cout << "huffman_decode: l_datalen=" << l_datalen << " codes start at (l_reader.get_bit_cursor().byte)=" << l_reader.get_bit_cursor().byte << std::endl;
+
+	l_decoded.m_buffer.resize(l_datalen);
+	std::uint8_t *l_out = l_decoded.m_buffer.data();
+	for (std::uint64_t i = 0; i < l_datalen; ++i) {
+		std::uint16_t l_entry = l_table[l_reader.peek_bits(HUFF_TABLE_BITS)];
+		if (l_entry != 0) {
+			l_out[i] = l_entry & 0xff;
+			l_reader.skip_bits(l_entry >> 8);
 			continue;
 		}
 
-		if (l_old == l_new) {
-			++l_count;
-			if (l_count == 254) { // 254 repeats = 255 characters
-				// flush window and restart the count if we reached count limit
-				l_out.write_uint8(RLE_ESCAPE);
-				l_out.write_uint8(l_old);
-				l_out.write_uint8(l_count + 1);
-				l_count = 0;
-				l_clear = true;
-			}
-		} else {
-			if (l_count > 0) {
-				// if we've repeated fewer than 4 times, just write the bytes themselves
-				if (l_count < 3) {
-					for (std::uint64_t i = 0; i <= l_count; ++i)
-						l_out.write_uint8(l_old);
-					l_count = 0;
-				} else {
-					// write out compound set
-					l_out.write_uint8(RLE_ESCAPE);
-					l_out.write_uint8(l_old);
-					l_out.write_uint8(l_count + 1);
-					l_count = 0;
-				}
-			} else {
-				// got different byte, but no repeat, so write out old
-				l_out.write_uint8(l_old);
+		// overflow: try each longer length in turn
+		std::uint64_t l_peek = l_reader.peek_bits(HUFF_MAX_CODE_LEN);
+		std::uint16_t l_len = HUFF_TABLE_BITS + 1;
+		for (; l_len <= HUFF_MAX_CODE_LEN; ++l_len) {
+			std::uint64_t l_rel = (l_peek >> (HUFF_MAX_CODE_LEN - l_len)) - l_first[l_len];
+			if (l_rel < l_count[l_len]) {
+				l_out[i] = l_sorted[l_offset[l_len] + l_rel];
+				break;
 			}
-			l_old = l_new;
 		}
-	} while (l_in.get_read_cursor() < l_in.size());
+		if (l_len > HUFF_MAX_CODE_LEN) {
+			data_exception e("huffman_decode: Invalid code in buffer.");
+			throw (e);
+		}
+		l_reader.skip_bits(l_len);
+	}
+	l_decoded.m_write_cursor = l_datalen;
+	return l_decoded;
+}
 
-	// flush window
-	if (!l_clear) {
-		if (l_count > 0) {
-			if (l_count < 3) {
-				for (std::uint64_t i = 0; i <= l_count; ++i)
-					l_out.write_uint8(l_old);
-				l_count = 0;
-			} else {
-				// write out compound set
-				l_out.write_uint8(RLE_ESCAPE);
-				l_out.write_uint8(l_old);
-				l_out.write_uint8(l_count + 1);
-				l_count = 0;
-			}
+data data::stream_codec::pull()
+{
+	data l_ret;
+	l_ret.m_buffer.swap(m_out);
+	l_ret.m_write_cursor = l_ret.m_buffer.size();
+	return l_ret;
+}
+
+// RLE format: runs of 4-255 identical bytes become escape, byte, count. A literal escape byte is written
+// twice, after which the escape value rotates by RLE_INCREMENT so a file full of one value doesn't double in size.
+const std::uint8_t RLE_ESCAPE_START = 0x55;
+const std::uint8_t RLE_INCREMENT = 0x3B;
+
+data::rle_stream_encoder::rle_stream_encoder()
+: m_escape(RLE_ESCAPE_START)
+, m_old(0)
+, m_count(0)
+, m_clear(true)
+{
+}
+
+void data::rle_stream_encoder::flush_run()
+{
+	if (m_count > 0) {
+		// if we've repeated fewer than 4 times, just write the bytes themselves
+		if (m_count < 3) {
+			for (std::uint64_t i = 0; i <= m_count; ++i)
+				m_out.push_back(m_old);
 		} else {
-			l_out.write_uint8(l_old);
+			// write out compound set
+			m_out.push_back(m_escape);
+			m_out.push_back(m_old);
+			m_out.push_back(m_count + 1);
 		}
+		m_count = 0;
+	} else {
+		// no repeat, so just write out old
+		m_out.push_back(m_old);
 	}
-	return l_out;
 }
 
-data data::rle_decode() const
+void data::rle_stream_encoder::push(const std::uint8_t *a_in, std::size_t a_len)
 {
-	std::uint8_t RLE_ESCAPE = 0x55;
-	const std::uint8_t RLE_INCREMENT = 0x3B;
+	// sliding window RLE
+	for (std::size_t i = 0; i < a_len; ++i) {
+		std::uint8_t l_new = a_in[i];
+
+		// did we encounter an escape? If so, flush the window then double it up, then rotate the escape
+		if (l_new == m_escape) {
+			if (!m_clear)
+				flush_run();
+			m_out.push_back(m_escape);
+			m_out.push_back(m_escape);
+			m_escape += RLE_INCREMENT;
+			m_clear = true;
+			continue;
+		}
 
-	data l_in = *this;
-	data l_out;
+		// first time through the loop (and after escapes), just stash away the first byte
+		if (m_clear) {
+			m_old = l_new;
+			m_clear = false;
+			continue;
+		}
+
+		if (m_old == l_new) {
+			++m_count;
+			if (m_count == 254) { // 254 repeats = 255 characters
+				// flush window and restart the count if we reached count limit
+				m_out.push_back(m_escape);
+				m_out.push_back(m_old);
+				m_out.push_back(m_count + 1);
+				m_count = 0;
+				m_clear = true;
+			}
+		} else {
+			flush_run();
+			m_old = l_new;
+		}
+	}
+}
 
-	// if we're empty, nothing to do
-	if (l_in.size() == 0)
-		return l_out;
+void data::rle_stream_encoder::finish()
+{
+	// flush window
+	if (!m_clear)
+		flush_run();
+	m_clear = true;
+}
 
-	std::uint64_t l_repeat = 0;
-	enum { COLLECTING, FOUND_ESCAPE, FOUND_CHAR } l_state = COLLECTING;
+data::rle_stream_decoder::rle_stream_decoder()
+: m_escape(RLE_ESCAPE_START)
+, m_state(COLLECTING)
+, m_repeat(0)
+{
+}
 
-	do {
-		std::uint8_t l_new = l_in.read_uint8();
-		switch (l_state) {
+void data::rle_stream_decoder::push(const std::uint8_t *a_in, std::size_t a_len)
+{
+	for (std::size_t i = 0; i < a_len; ++i) {
+		std::uint8_t l_new = a_in[i];
+		switch (m_state) {
 			case COLLECTING:
-				if (l_new == RLE_ESCAPE) {
-					l_state = FOUND_ESCAPE;
+				if (l_new == m_escape) {
+					m_state = FOUND_ESCAPE;
 				} else {
 					// just a normal char, so write it out
-					l_out.write_uint8(l_new);
+					m_out.push_back(l_new);
 				}
 				break;
 			case FOUND_ESCAPE:
-				if (l_new == RLE_ESCAPE) {
+				if (l_new == m_escape) {
 					// found second escape character, so write it then rotate escape
-					l_out.write_uint8(l_new);
-					RLE_ESCAPE += RLE_INCREMENT;
-					l_state = COLLECTING;
+					m_out.push_back(l_new);
+					m_escape += RLE_INCREMENT;
+					m_state = COLLECTING;
 				} else {
 					// something else, must be the char we need to repeat
-					l_repeat = l_new;
-					l_state = FOUND_CHAR;
+					m_repeat = l_new;
+					m_state = FOUND_CHAR;
 				}
 				break;
 			case FOUND_CHAR:
 				if (l_new > 0) {
-					l_out.fill(l_new, l_repeat);
-					l_state = COLLECTING;
+					m_out.insert(m_out.end(), l_new, m_repeat);
+					m_state = COLLECTING;
 				} else {
-					// value of 0 is illegali in a repeat construct, so data stream must be corrupted
+					// value of 0 is illegal in a repeat construct, so data stream must be corrupted
 					data_exception e("rle_decode: Illegal character in stream, possible data corruption.");
 					throw (e);
 				}
 				break;
 		}
-	} while (l_in.get_read_cursor() < l_in.size());
-	return l_out;
+	}
 }
 
-data data::range_encode(std::function<void(std::uint64_t, std::uint64_t)> a_status_cb)
+data data::rle_encode() const
 {
-	data l_work = rle_encode();
-	data l_ret = l_work.range_encode_private(l_work, a_status_cb);
-	return l_ret;
+	rle_stream_encoder l_enc;
+	std::span<const std::uint8_t> l_src = m_circular_mode ? contents() : contents().subspan(m_read_cursor);
+	l_enc.push(l_src.data(), l_src.size());
+	l_enc.finish();
+	return l_enc.pull();
 }
 
-data data::range_decode(std::function<void(std::uint64_t, std::uint64_t)> a_status_cb)
+data data::rle_decode() const
+{
+	rle_stream_decoder l_dec;
+	std::span<const std::uint8_t> l_src = m_circular_mode ? contents() : contents().subspan(m_read_cursor);
+	l_dec.push(l_src.data(), l_src.size());
+	l_dec.finish();
+	return l_dec.pull();
+}
+
+data data::lz_encode(lz_backend a_backend) const
+{
+	// Token stream: a flag byte ahead of every 8 items, most significant bit first, 1 for a literal byte and
+	// 0 for a match. A match is a 16 bit big endian offset back into the output and a byte of length - LZ_MIN_MATCH.
+	const std::uint8_t *l_in = contents().data();
+	const std::size_t l_len = size();
+	std::vector<std::uint8_t> l_tokens;
+	l_tokens.reserve(l_len + (l_len >> 3) + 1);
+	std::size_t l_flag_pos = 0;
+	std::uint16_t l_flag_bit = 8;
+	auto begin_item = [&](bool a_literal) {
+		if (l_flag_bit == 8) {
+			l_flag_pos = l_tokens.size();
+			l_tokens.push_back(0);
+			l_flag_bit = 0;
+		}
+		if (a_literal)
+			l_tokens[l_flag_pos] |= (0x80 >> l_flag_bit);
+		++l_flag_bit;
+	};
+
+	// hash chains: l_head holds the latest position for each hash, l_prev the one before it for each position
+	// in the window. Positions are added lazily, just before a search needs them.
+	const std::size_t l_window_mask = LZ_MAX_OFFSET;
+	std::vector<std::int64_t> l_head(1 << LZ_HASH_BITS, -1);
+	std::vector<std::int64_t> l_prev(l_window_mask + 1, -1);
+	std::size_t l_inserted = 0;
+	auto hash = [&](std::size_t a_pos) -> std::uint32_t {
+		std::uint32_t l_key = l_in[a_pos] | (l_in[a_pos + 1] << 8) | (l_in[a_pos + 2] << 16);
+		return (l_key * 2654435761U) >> (32 - LZ_HASH_BITS);
+	};
+	auto insert_to = [&](std::size_t a_pos) {
+		for (; l_inserted < a_pos; ++l_inserted) {
+			if (l_inserted + LZ_MIN_MATCH > l_len)
+				continue;
+			std::uint32_t l_hash = hash(l_inserted);
+			l_prev[l_inserted & l_window_mask] = l_head[l_hash];
+			l_head[l_hash] = l_inserted;
+		}
+	};
+	auto find_match = [&](std::size_t a_pos, std::size_t& a_offset) -> std::size_t {
+		if (a_pos + LZ_MIN_MATCH > l_len)
+			return 0;
+		insert_to(a_pos);
+		std::size_t l_max = std::min(LZ_MAX_MATCH, l_len - a_pos);
+		std::size_t l_best = 0;
+		std::int64_t l_cand = l_head[hash(a_pos)];
+		for (std::size_t l_depth = 0; (l_cand >= 0) && (l_depth < LZ_MAX_CHAIN); ++l_depth) {
+			if (a_pos - l_cand > LZ_MAX_OFFSET)
+				break;
+			// can only beat the best so far if it matches one byte further
+			if (l_in[l_cand + l_best] == l_in[a_pos + l_best]) {
+				std::size_t l_match = 0;
+				while ((l_match < l_max) && (l_in[l_cand + l_match] == l_in[a_pos + l_match]))
+					++l_match;
+				if (l_match > l_best) {
+					l_best = l_match;
+					a_offset = a_pos - l_cand;
+					if (l_best == l_max)
+						break;
+				}
+			}
+			l_cand = l_prev[l_cand & l_window_mask];
+		}
+		return (l_best >= LZ_MIN_MATCH) ? l_best : 0;
+	};
+
+	std::size_t l_pos = 0;
+	std::size_t l_match_len = 0;
+	std::size_t l_match_off = 0;
+	bool l_have_match = false; // l_match_len/l_match_off were already found for l_pos by the lazy check
+	while (l_pos < l_len) {
+		if (!l_have_match)
+			l_match_len = find_match(l_pos, l_match_off);
+		l_have_match = false;
+
+		// lazy matching: if the next byte starts a longer match, emit this one as a literal instead
+		if ((l_match_len > 0) && (l_match_len < LZ_LAZY_LIMIT)) {
+			std::size_t l_next_off = 0;
+			std::size_t l_next_len = find_match(l_pos + 1, l_next_off);
+			if (l_next_len > l_match_len) {
+				begin_item(true);
+				l_tokens.push_back(l_in[l_pos++]);
+				l_match_len = l_next_len;
+				l_match_off = l_next_off;
+				l_have_match = true;
+				continue;
+			}
+		}
+
+		if (l_match_len > 0) {
+			begin_item(false);
+			l_tokens.push_back(l_match_off >> 8);
+			l_tokens.push_back(l_match_off & 0xff);
+			l_tokens.push_back(l_match_len - LZ_MIN_MATCH);
+			l_pos += l_match_len;
+		} else {
+			begin_item(true);
+			l_tokens.push_back(l_in[l_pos++]);
+		}
+	}
+
+	data l_payload;
+	l_payload.m_buffer.swap(l_tokens);
+	l_payload.m_write_cursor = l_payload.m_buffer.size();
+	switch (a_backend) {
+		case LZ_RAW:
+			break;
+		case LZ_HUFFMAN:
+			l_payload = l_payload.huffman_encode();
+			break;
+		case LZ_RANGE:
+			l_payload = l_payload.range_encode();
+			break;
+		default:
+			data_exception e("lz_encode: Unknown backend.");
+			throw (e);
+	}
+
+	data l_ret;
+	l_ret.reserve(10 + l_payload.size());
+	l_ret.set_network_byte_order(true);
+	l_ret.write_uint32(LZ_MAGIC_COOKIE);
+	l_ret.write_uint8(a_backend);
+	l_ret.write_uint40(l_len);
+	l_ret += l_payload;
+	return l_ret;
+}
+
+data data::lz_decode() const
+{
+	// header: cookie, backend, 40 bit original length, read in place
+	std::span<const std::uint8_t> l_src = contents();
+	if (l_src.size() < 10) {
+		data_exception e("lz_decode: Buffer is too short.");
+		throw (e);
+	}
+	data_view l_in(l_src);
+	l_in.set_network_byte_order(true);
+	if (l_in.read_uint32() != LZ_MAGIC_COOKIE) {
+		data_exception e("lz_decode: Magic cookie missing from buffer.");
+		throw (e);
+	}
+	std::uint8_t l_backend = l_in.read_uint8();
+	std::uint64_t l_original_size = l_in.read_uint40();
+
+	// raw tokens are used where they are; the entropy coded ones are decoded into l_tokens
+	std::span<const std::uint8_t> l_token_span = l_src.subspan(10);
+	data l_tokens;
+	if (l_backend != LZ_RAW) {
+		l_tokens.write_bytes(l_token_span.data(), l_token_span.size());
+		switch (l_backend) {
+			case LZ_HUFFMAN:
+				l_tokens = l_tokens.huffman_decode();
+				break;
+			case LZ_RANGE:
+				l_tokens = l_tokens.range_decode();
+				break;
+			default:
+				data_exception e("lz_decode: Unknown backend.");
+				throw (e);
+		}
+		l_token_span = l_tokens.contents();
+	}
+
+	// a match token is 3 bytes plus a bit of flag for at most LZ_MAX_MATCH bytes of output
+	if (l_original_size > l_token_span.size() * (LZ_MAX_MATCH / 3)) {
+		data_exception e("lz_decode: Original length in buffer is invalid.");
+		throw (e);
+	}
+	data l_ret;
+	l_ret.m_buffer.resize(l_original_size);
+	std::uint8_t *l_out = l_ret.m_buffer.data();
+	const std::uint8_t *l_tok = l_token_span.data();
+	const std::size_t l_tok_len = l_token_span.size();
+	std::size_t l_tok_pos = 0;
+	std::size_t l_pos = 0;
+	std::uint8_t l_flags = 0;
+	std::uint16_t l_flag_bit = 8;
+	while (l_pos < l_original_size) {
+		if (l_flag_bit == 8) {
+			if (l_tok_pos >= l_tok_len)
+				break;
+			l_flags = l_tok[l_tok_pos++];
+			l_flag_bit = 0;
+		}
+		bool l_literal = (l_flags & (0x80 >> l_flag_bit++)) != 0;
+		if (l_literal) {
+			if (l_tok_pos >= l_tok_len)
+				break;
+			l_out[l_pos++] = l_tok[l_tok_pos++];
+			continue;
+		}
+		if (l_tok_pos + 3 > l_tok_len)
+			break;
+		std::size_t l_offset = (l_tok[l_tok_pos] << 8) | l_tok[l_tok_pos + 1];
+		std::size_t l_match_len = l_tok[l_tok_pos + 2] + LZ_MIN_MATCH;
+		l_tok_pos += 3;
+		if ((l_offset == 0) || (l_offset > l_pos) || (l_match_len > l_original_size - l_pos)) {
+			data_exception e("lz_decode: Invalid match in buffer.");
+			throw (e);
+		}
+		// byte at a time, the match may overlap the bytes it produces
+		const std::uint8_t *l_src = l_out + l_pos - l_offset;
+		for (std::size_t i = 0; i < l_match_len; ++i)
+			l_out[l_pos + i] = l_src[i];
+		l_pos += l_match_len;
+	}
+	if (l_pos != l_original_size) {
+		data_exception e("lz_decode: Token stream is truncated.");
+		throw (e);
+	}
+	l_ret.m_write_cursor = l_original_size;
+	return l_ret;
+}
+
+data data::range_encode(std::function<void(std::uint64_t, std::uint64_t)> a_status_cb, range_model a_model)
+{
+	data l_work = rle_encode();
+	if (a_model != RANGE_LONG_DOUBLE)
+		return l_work.range_encode_integer(l_work, a_status_cb, (a_model == RANGE_ORDER1));
+	data l_ret = l_work.range_encode_private(l_work, a_status_cb);
+	return l_ret;
+}
+
+data data::range_decode(std::function<void(std::uint64_t, std::uint64_t)> a_status_cb)
 {
 	data l_work = range_decode_private(*this, a_status_cb);
 	data l_ret = l_work.rle_decode();
@@ -2927,13 +4504,24 @@ struct symbol {
 const std::uint16_t m_cookie = 0xaa5b;
 const std::uint16_t m_cookie_multi = 0xaadc;
 const std::size_t m_seg_max = 262144; // cannot exceed 16MB.. 24 bit value
-std::array<symbol, 256> m_probs;
-std::uint32_t m_message_len; // cannot exceed 1TB. This should be big enough for most files.
-std::uint32_t m_segment_len;
-std::uint64_t m_min_range;
-std::uint32_t m_max_count;
+const std::uint16_t m_cookie_int = 0xaa1c; // integer coder, always followed by a segment count
+const std::uint16_t m_cookie_o1 = 0xaa1d; // integer coder with adaptive order-1 model, same layout as m_cookie_int
+const std::uint32_t m_int_total_bits = 15; // integer coder frequencies are scaled to add up to 1 << m_int_total_bits
+const std::uint32_t m_int_top = 1 << 24; // integer coder renormalizes when its range drops below this
+
+// Everything the coder used to keep in file-scope globals. Each call to range_encode_private/range_decode_private
+// gets its own, so any number of threads can compress or decompress at once.
+class data::range_context {
+public:
+	void assign_ranges(std::uint64_t a_lo, std::uint64_t a_hi);
+	std::array<symbol, 256> m_probs;
+	std::uint32_t m_message_len; // cannot exceed 1TB. This should be big enough for most files.
+	std::uint32_t m_segment_len;
+	std::uint64_t m_min_range;
+	std::uint32_t m_max_count;
+};
 
-void data::assign_ranges(std::uint64_t a_lo, std::uint64_t a_hi)
+void data::range_context::assign_ranges(std::uint64_t a_lo, std::uint64_t a_hi)
 {
 	//std::cout << "characterizing range a_lo " << std::hex << std::setfill('0') << std::setw(16) << a_lo << " a_hi " << a_hi << " size " << (a_hi - a_lo) << std::endl;
 	if (a_hi == a_lo) {
@@ -2973,11 +4561,12 @@ void data::default_predicate(std::uint64_t a_num, std::uint64_t a_denom)
 
 ss::data data::range_encode_private(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb)
 {
-	m_message_len = a_data.size();
+	range_context l_ctx;
+	l_ctx.m_message_len = a_data.size();
 	std::uint16_t l_seg_count = 1;
-	if (m_message_len > m_seg_max) {
-		l_seg_count = (m_message_len / m_seg_max);
-		if ((m_message_len % m_seg_max) > 0)
+	if (l_ctx.m_message_len > m_seg_max) {
+		l_seg_count = (l_ctx.m_message_len / m_seg_max);
+		if ((l_ctx.m_message_len % m_seg_max) > 0)
 			l_seg_count++;
 	}
 	//std::cout << "preparing to compress " << l_seg_count << " segments." << std::endl;
@@ -2990,50 +4579,50 @@ ss::data data::range_encode_private(ss::data& a_data, std::function<void(std::ui
 		l_comp.write_uint16(m_cookie_multi);
 		l_comp.write_uint16(l_seg_count);
 	}
-	l_comp.write_uint40(m_message_len);
+	l_comp.write_uint40(l_ctx.m_message_len);
 
 	for (std::size_t l_seg = 0; l_seg < l_seg_count; ++l_seg) {
 		ss::data l_bitstream;
 		l_bitstream.set_network_byte_order(true);
 		std::size_t l_segstart = l_seg * m_seg_max;
 		std::size_t l_segend = ((l_seg + 1) * m_seg_max);
-		if (l_segend > m_message_len)
-			l_segend = l_segstart + (m_message_len - (l_seg * m_seg_max));
-		m_segment_len = l_segend - l_segstart;
+		if (l_segend > l_ctx.m_message_len)
+			l_segend = l_segstart + (l_ctx.m_message_len - (l_seg * m_seg_max));
+		l_ctx.m_segment_len = l_segend - l_segstart;
 		if (l_seg_count > 1)
 			a_status_cb(l_seg, l_seg_count);
 		//std::cout << "processing segment " << l_seg + 1 << " segstart " << l_segstart << " segend " << l_segend << std::endl;
 
 		// compute probabilities
 		for (std::size_t i = 0; i < 256; ++i)
-			m_probs[i] = { 0, 0, 0, 0 }; // init them
+			l_ctx.m_probs[i] = { 0, 0, 0, 0 }; // init them
 //		std::cout << "characterizing probabilities for " << l_segstart << ", " << l_segend << std::endl;
 		for (std::size_t i = l_segstart; i < l_segend; ++i) 
-			m_probs[a_data[i]].count++;
+			l_ctx.m_probs[a_data[i]].count++;
 		// find max symbol count
-		m_max_count = 0;
+		l_ctx.m_max_count = 0;
 		for (std::size_t i = 0; i < 256; ++i)
-			m_max_count = std::max(m_max_count, m_probs[i].count);
+			l_ctx.m_max_count = std::max(l_ctx.m_max_count, l_ctx.m_probs[i].count);
 
 		hidetect l_work_lo;
 		hidetect l_work_hi;
 		l_work_lo.val = 0;
 		l_work_hi.val = ULLONG_MAX;
-		assign_ranges(l_work_lo.val, l_work_hi.val);
+		l_ctx.assign_ranges(l_work_lo.val, l_work_hi.val);
 		for (std::size_t i = l_segstart; i < l_segend; ++i) {
 //			if ((i % 100000) == 0)
 //				std::cout << ".";
 			//std::cout << "encode loop: position " << i << " read symbol " << std::hex << std::setfill('0') << std::setw(2) << (int)a_data[i] << std::endl;
-			l_work_lo.val = m_probs[a_data[i]].lo;
-			l_work_hi.val = m_probs[a_data[i]].hi;
-			assign_ranges(l_work_lo.val, l_work_hi.val);
+			l_work_lo.val = l_ctx.m_probs[a_data[i]].lo;
+			l_work_hi.val = l_ctx.m_probs[a_data[i]].hi;
+			l_ctx.assign_ranges(l_work_lo.val, l_work_hi.val);
 			while (l_work_lo.hibyte == l_work_hi.hibyte) {
 				//std::cout << "--- normalizing... writing " << std::hex << (int)l_work_lo.hibyte << std::endl;
 				l_bitstream.write_uint8(l_work_lo.hibyte);
 				l_work_lo.val <<= 8;
 				l_work_hi.val <<= 8;
 				l_work_hi.lobyte = 0xff;
-				assign_ranges(l_work_lo.val, l_work_hi.val);
+				l_ctx.assign_ranges(l_work_lo.val, l_work_hi.val);
 			}
 		}
 		l_bitstream.write_uint64(l_work_lo.val);
@@ -3041,14 +4630,14 @@ ss::data data::range_encode_private(ss::data& a_data, std::function<void(std::ui
 //		std::cout << "compressed " << std::dec << (l_segend - l_segstart) << " symbols, compressed data len=" << l_bitstream.size() << std::endl;
 
 		// construct full symbol count table
-//		std::cout << "m_max_count " << std::dec << m_max_count << " bits " << std::bit_width(m_max_count) << std::endl;
+//		std::cout << "l_ctx.m_max_count " << std::dec << l_ctx.m_max_count << " bits " << std::bit_width(l_ctx.m_max_count) << std::endl;
 		ss::data l_cnttbl_full;
 		l_cnttbl_full.write_bit(false);
 		std::uint64_t l_cntwidth = 0;
-		l_cntwidth = std::bit_width(m_max_count);
+		l_cntwidth = std::bit_width(l_ctx.m_max_count);
 		l_cnttbl_full.write_bits(l_cntwidth, 5); // 5 bit number from 0-31
 		for (std::size_t i = 0; i < 256; ++i) {
-			l_cnttbl_full.write_bits(m_probs[i].count, l_cntwidth);
+			l_cnttbl_full.write_bits(l_ctx.m_probs[i].count, l_cntwidth);
 		}
 
 		// construct enumerated count table
@@ -3057,13 +4646,13 @@ ss::data data::range_encode_private(ss::data& a_data, std::function<void(std::ui
 		l_cnttbl_enum.write_bits(l_cntwidth, 5);
 		std::uint8_t l_enum_entries = 0;
 		for (std::size_t i = 0; i < 256; ++i)
-			if (m_probs[i].count > 0)
+			if (l_ctx.m_probs[i].count > 0)
 				l_enum_entries++;
 		l_cnttbl_enum.write_bits(l_enum_entries, 8);
 		for (std::size_t i = 0; i < 256; ++i) {
-			if (m_probs[i].count > 0) {
+			if (l_ctx.m_probs[i].count > 0) {
 				l_cnttbl_enum.write_bits(i, 8);
-				l_cnttbl_enum.write_bits(m_probs[i].count, l_cntwidth);
+				l_cnttbl_enum.write_bits(l_ctx.m_probs[i].count, l_cntwidth);
 			}
 		}
 
@@ -3085,10 +4674,13 @@ ss::data data::range_encode_private(ss::data& a_data, std::function<void(std::ui
 
 ss::data data::range_decode_private(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb)
 {
+	range_context l_ctx;
 	ss::data l_ret;
 
 	a_data.set_network_byte_order(true); // just to be on the safe side
 	std::uint16_t l_cookie = a_data.read_uint16();
+	if ((l_cookie == m_cookie_int) || (l_cookie == m_cookie_o1))
+		return range_decode_integer(a_data, a_status_cb, (l_cookie == m_cookie_o1));
 	if ((l_cookie != m_cookie) && (l_cookie != m_cookie_multi)) {
 		// cookie error
 //		std::cout << "Cookie mismatch" << std::endl;
@@ -3108,11 +4700,11 @@ ss::data data::range_decode_private(ss::data& a_data, std::function<void(std::ui
 		std::size_t l_segend = ((l_seg + 1) * m_seg_max);
 		if (l_segend > l_original_size)
 			l_segend = l_segstart + (l_original_size - (l_seg * m_seg_max));
-		m_segment_len = l_segend - l_segstart;
+		l_ctx.m_segment_len = l_segend - l_segstart;
 		std::uint32_t l_seg_bitstream_size = a_data.read_uint24();
 		if (l_seg_count > 1)
 			a_status_cb(l_seg, l_seg_count);
-		//std::cout << "decoding segment " << l_seg + 1 << " segstart " << l_segstart << " segend " << l_segend << " size " << m_segment_len << " bitstream size " << l_seg_bitstream_size << std::endl;
+		//std::cout << "decoding segment " << l_seg + 1 << " segstart " << l_segstart << " segend " << l_segend << " size " << l_ctx.m_segment_len << " bitstream size " << l_seg_bitstream_size << std::endl;
 	
 		// read count table
 		ss::data::bit_cursor l_bitcursor;
@@ -3126,28 +4718,28 @@ ss::data data::range_decode_private(ss::data& a_data, std::function<void(std::ui
 			std::uint8_t l_enum_entries = a_data.read_bits(8);
 			// clear the table first
 			for (std::size_t i = 0; i < 256; ++i) {
-				m_probs[i].count = 0;
-				m_probs[i].lo = 0;
-				m_probs[i].hi = 0;
-				m_probs[i].size = 0;
+				l_ctx.m_probs[i].count = 0;
+				l_ctx.m_probs[i].lo = 0;
+				l_ctx.m_probs[i].hi = 0;
+				l_ctx.m_probs[i].size = 0;
 			}
 			for (std::size_t i = 0; i < l_enum_entries; ++i) {
 				std::uint8_t l_symbol = a_data.read_bits(8);
 				std::uint32_t l_frequency = a_data.read_bits(l_cntwidth);
-				m_probs[l_symbol].count = l_frequency;
+				l_ctx.m_probs[l_symbol].count = l_frequency;
 			}
 		} else {
 //			std::cout << "reading full count table..." << std::endl;
 			// read full count table
 			std::uint64_t l_cntwidth = a_data.read_bits(5);
 			for (std::size_t i = 0; i < 256; ++i) {
-				m_probs[i].count = a_data.read_bits(l_cntwidth);
-				m_probs[i].lo = 0;
-				m_probs[i].hi = 0;
-				m_probs[i].size = 0;
+				l_ctx.m_probs[i].count = a_data.read_bits(l_cntwidth);
+				l_ctx.m_probs[i].lo = 0;
+				l_ctx.m_probs[i].hi = 0;
+				l_ctx.m_probs[i].size = 0;
 			}
 		}
-		assign_ranges(0, ULLONG_MAX);
+		l_ctx.assign_ranges(0, ULLONG_MAX);
 		l_bitcursor = a_data.get_read_bit_cursor();
 		l_bitcursor.advance_to_next_whole_byte();
 		a_data.set_read_bit_cursor(l_bitcursor);
@@ -3168,15 +4760,15 @@ ss::data data::range_decode_private(ss::data& a_data, std::function<void(std::ui
 		while (1) {
 			bool l_found = false;
 			for (std::size_t i = 0; i < 256; ++i) {
-				if ((l_work.val <= m_probs[i].hi) && (l_work.val >= m_probs[i].lo) && (m_probs[i].count > 0)) {
+				if ((l_work.val <= l_ctx.m_probs[i].hi) && (l_work.val >= l_ctx.m_probs[i].lo) && (l_ctx.m_probs[i].count > 0)) {
 					//std::cout << "pos " << std::dec << l_pos << " decoded symbol " << std::hex << std::setw(2) << i << " = " << (char)i << std::endl;
 					l_ret.write_uint8(i);
 					l_pos++;
 					l_found = true;
 					// if the high byte of the ranges match, scoot the values over and read in next byte from the stream to be the lobyte
-					l_lo.val = m_probs[i].lo;
-					l_hi.val = m_probs[i].hi;
-					assign_ranges(l_lo.val, l_hi.val);
+					l_lo.val = l_ctx.m_probs[i].lo;
+					l_hi.val = l_ctx.m_probs[i].hi;
+					l_ctx.assign_ranges(l_lo.val, l_hi.val);
 					while (l_lo.hibyte == l_hi.hibyte) {
 						l_lo.val <<= 8;
 						l_hi.val <<= 8;
@@ -3186,19 +4778,19 @@ ss::data data::range_decode_private(ss::data& a_data, std::function<void(std::ui
 						l_bitstream_pos++;
 						//std::cout << "---read from bitstream: " << std::hex << (int)l_work.lobyte << " bitstream_pos " << std::dec << l_bitstream_pos << std::endl;
 					}
-					assign_ranges(l_lo.val, l_hi.val);
+					l_ctx.assign_ranges(l_lo.val, l_hi.val);
 					break;
 				}
 			}
-			if (l_pos >= m_segment_len)
+			if (l_pos >= l_ctx.m_segment_len)
 				break;
 			if (!l_found) {
 				// exhausted the for loop... didn't find the range. Fatal error
 				std::cout << "unable to find range for work " << std::hex << l_work.val << " at pos " << std::dec << l_pos << std::endl;
 				std::cout << "l_lo.val " << std::hex << l_lo.val << " l_hi.val " << l_hi.val << std::endl;
 				for (std::size_t i = 0; i < 256; ++i) {
-					if (m_probs[i].count > 0) {
-						std::cout << "sym " << std::hex << (int)i << " count " << std::dec << std::setfill(' ') << std::setw(0) << (int)m_probs[i].count << std::hex << std::setfill('0') << std::setw(16) << " l_sym.lo " << m_probs[i].lo << " l_sym.hi " << m_probs[i].hi << std::dec << " size " << m_probs[i].size << std::endl;
+					if (l_ctx.m_probs[i].count > 0) {
+						std::cout << "sym " << std::hex << (int)i << " count " << std::dec << std::setfill(' ') << std::setw(0) << (int)l_ctx.m_probs[i].count << std::hex << std::setfill('0') << std::setw(16) << " l_sym.lo " << l_ctx.m_probs[i].lo << " l_sym.hi " << l_ctx.m_probs[i].hi << std::dec << " size " << l_ctx.m_probs[i].size << std::endl;
 					}
 				}
 				exit(EXIT_FAILURE);
@@ -3213,5 +4805,883 @@ ss::data data::range_decode_private(ss::data& a_data, std::function<void(std::ui
 	return l_ret;
 }
 
+
+// Scale a segment's symbol counts so they add up to exactly 1 << m_int_total_bits.
+// Every symbol that occurs keeps a frequency of at least 1.
+static void range_normalize_counts(const std::array<std::uint32_t, 256>& a_counts, std::uint64_t a_total, std::array<std::uint32_t, 256>& a_freqs)
+{
+	const std::int64_t l_target = 1 << m_int_total_bits;
+	std::int64_t l_sum = 0;
+	for (std::size_t i = 0; i < 256; ++i) {
+		a_freqs[i] = 0;
+		if (a_counts[i] > 0)
+			a_freqs[i] = std::max<std::uint64_t>(1, ((std::uint64_t)a_counts[i] << m_int_total_bits) / a_total);
+		l_sum += a_freqs[i];
+	}
+	// rounding down leaves us short, rounding rare symbols up to 1 may leave us over.
+	// Settle the difference with the most frequent symbols, where it costs the least.
+	while (l_sum != l_target) {
+		std::size_t l_biggest = 0;
+		for (std::size_t i = 1; i < 256; ++i)
+			if (a_freqs[i] > a_freqs[l_biggest])
+				l_biggest = i;
+		std::int64_t l_adjust = l_target - l_sum;
+		if (l_adjust < 0)
+			l_adjust = std::max<std::int64_t>(l_adjust, 1 - (std::int64_t)a_freqs[l_biggest]);
+		a_freqs[l_biggest] += l_adjust;
+		l_sum += l_adjust;
+	}
+}
+
+// Append a frequency table to a_out, either all 256 entries or just the ones in use, whichever is smaller.
+// Same layout as the count tables in the long double coder.
+static void range_write_freq_table(ss::data& a_out, const std::array<std::uint32_t, 256>& a_freqs)
+{
+	std::uint32_t l_max = 0;
+	std::uint16_t l_entries = 0;
+	for (std::size_t i = 0; i < 256; ++i) {
+		l_max = std::max(l_max, a_freqs[i]);
+		if (a_freqs[i] > 0)
+			l_entries++;
+	}
+	std::uint64_t l_width = std::bit_width(l_max);
+	ss::data l_table;
+	ss::data::bit_writer l_writer(l_table);
+	if ((256 * l_width) <= (8 + l_entries * (8 + l_width))) {
+		l_writer.write_bit(false);
+		l_writer.write_bits(l_width, 5);
+		for (std::size_t i = 0; i < 256; ++i)
+			l_writer.write_bits(a_freqs[i], l_width);
+	} else {
+		l_writer.write_bit(true);
+		l_writer.write_bits(l_width, 5);
+		l_writer.write_bits(l_entries, 8);
+		for (std::size_t i = 0; i < 256; ++i) {
+			if (a_freqs[i] > 0) {
+				l_writer.write_bits(i, 8);
+				l_writer.write_bits(a_freqs[i], l_width);
+			}
+		}
+	}
+	l_writer.flush();
+	a_out += l_table;
+}
+
+static void range_read_freq_table(ss::data::bit_reader& a_reader, std::array<std::uint32_t, 256>& a_freqs)
+{
+	bool l_is_enumerated = a_reader.read_bit();
+	std::uint16_t l_width = a_reader.read_bits(5);
+	for (std::size_t i = 0; i < 256; ++i)
+		a_freqs[i] = 0;
+	if (l_is_enumerated) {
+		std::uint16_t l_entries = a_reader.read_bits(8);
+		for (std::size_t i = 0; i < l_entries; ++i) {
+			std::uint8_t l_symbol = a_reader.read_bits(8);
+			a_freqs[l_symbol] = a_reader.read_bits(l_width);
+		}
+	} else {
+		for (std::size_t i = 0; i < 256; ++i)
+			a_freqs[i] = a_reader.read_bits(l_width);
+	}
+	a_reader.advance_to_next_whole_byte();
+}
+
+// 32 bit range coder with carry propagation, shared by the integer coder's models. Low is kept in 64 bits
+// so a carry out of the top shows up in bit 32. Callers turn their model's total into a scale with
+// scale()/scale_pow2() and then code a symbol's cumulative frequency and frequency at that scale.
+class range_int_encoder {
+public:
+	range_int_encoder(std::vector<std::uint8_t>& a_out) : m_out(a_out), m_low(0), m_range(0xffffffff), m_cache(0), m_cache_size(1) { }
+	std::uint32_t scale(std::uint32_t a_total) const { return m_range / a_total; }
+	std::uint32_t scale_pow2(std::uint32_t a_total_bits) const { return m_range >> a_total_bits; }
+	void encode(std::uint32_t a_scale, std::uint32_t a_cum, std::uint32_t a_freq)
+	{
+		m_low += (std::uint64_t)a_scale * a_cum;
+		m_range = a_scale * a_freq;
+		while (m_range < m_int_top) {
+			m_range <<= 8;
+			shift_low();
+		}
+	}
+	void flush()
+	{
+		for (std::size_t i = 0; i < 5; ++i)
+			shift_low();
+	}
+protected:
+	// hold back the top byte of low (and any run of 0xff behind it) until we know a carry can't reach it
+	void shift_low()
+	{
+		if (((std::uint32_t)m_low < 0xff000000) || ((m_low >> 32) != 0)) {
+			std::uint8_t l_carry = m_low >> 32;
+			std::uint8_t l_byte = m_cache;
+			do {
+				m_out.push_back(l_byte + l_carry);
+				l_byte = 0xff;
+			} while (--m_cache_size != 0);
+			m_cache = (m_low >> 24) & 0xff;
+		}
+		m_cache_size++;
+		m_low = (m_low & 0x00ffffff) << 8;
+	}
+	std::vector<std::uint8_t>& m_out;
+	std::uint64_t m_low;
+	std::uint32_t m_range;
+	std::uint8_t m_cache;
+	std::uint64_t m_cache_size;
+};
+
+class range_int_decoder {
+public:
+	range_int_decoder(const std::uint8_t *a_src, std::size_t a_len)
+	: m_src(a_src), m_src_end(a_src + a_len), m_code(0), m_range(0xffffffff)
+	{
+		for (std::size_t i = 0; i < 5; ++i)
+			m_code = (m_code << 8) | next_byte(); // the first byte is the encoder's empty cache, always 0
+	}
+	std::uint32_t scale(std::uint32_t a_total) const { return m_range / a_total; }
+	std::uint32_t scale_pow2(std::uint32_t a_total_bits) const { return m_range >> a_total_bits; }
+	std::uint32_t value(std::uint32_t a_scale) const { return m_code / a_scale; } // where we are in the model's total
+	void decode(std::uint32_t a_scale, std::uint32_t a_cum, std::uint32_t a_freq)
+	{
+		m_code -= a_scale * a_cum;
+		m_range = a_scale * a_freq;
+		while (m_range < m_int_top) {
+			m_code = (m_code << 8) | next_byte();
+			m_range <<= 8;
+		}
+	}
+protected:
+	std::uint8_t next_byte() { return (m_src < m_src_end) ? *m_src++ : 0; }
+	const std::uint8_t *m_src;
+	const std::uint8_t *m_src_end;
+	std::uint32_t m_code;
+	std::uint32_t m_range;
+};
+
+// Thread pool for the integer coder's segments (and the threaded cipher modes). The workers are
+// ss::ccl::work_queue_threads fed from one process-wide queue, started on first use and grown to the largest
+// thread count any call has asked for, so a call doesn't pay for starting and joining threads.
+static thread_local bool m_range_worker_thread = false; // nested calls from a worker run serially
+
+class range_worker : public ss::ccl::work_queue_thread<std::function<void()> > {
+public:
+	range_worker(const std::string& a_logname, ss::ccl::work_queue<std::function<void()> >& a_queue)
+	: ss::ccl::work_queue_thread<std::function<void()> >(a_logname, a_queue) { }
+	virtual void dispatch(std::function<void()> a_work_item) { m_range_worker_thread = true; a_work_item(); }
+};
+
+class range_pool {
+public:
+	// never destroyed, so its workers don't depend on the order other statics go away in at exit
+	static range_pool& get() { static range_pool *l_pool = new range_pool; return *l_pool; }
+	// queue a_count copies of a_item, with at least that many workers to run them
+	void run(std::size_t a_count, const std::function<void()>& a_item)
+	{
+		{
+			std::lock_guard<std::mutex> l_guard(m_mutex);
+			while (m_workers.size() < a_count) {
+				m_workers.push_back(std::make_unique<range_worker>(std::format("range_worker_{}", m_workers.size()), m_queue));
+				m_workers.back()->start();
+			}
+		}
+		for (std::size_t i = 0; i < a_count; ++i)
+			m_queue.add_work_item(a_item);
+	}
+protected:
+	std::mutex m_mutex;
+	ss::ccl::work_queue<std::function<void()> > m_queue;
+	std::vector<std::unique_ptr<range_worker> > m_workers;
+};
+
+// Run a_job for every segment on up to a_threads pool workers (0 for one per core), each taking the next
+// segment until they're all gone. The calling thread hands out status callbacks as segments finish and
+// rethrows the first exception a job hit; a throwing status callback stops the workers the same way.
+static void range_run_segments(std::size_t a_seg_count, std::function<void(std::size_t)> a_job, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb, std::size_t a_threads)
+{
+	std::size_t l_threads = std::min<std::size_t>(a_threads ? a_threads : std::thread::hardware_concurrency(), a_seg_count);
+	if ((l_threads <= 1) || (m_range_worker_thread)) {
+		for (std::size_t l_seg = 0; l_seg < a_seg_count; ++l_seg) {
+			if (a_seg_count > 1)
+				a_status_cb(l_seg, a_seg_count);
+			a_job(l_seg);
+		}
+		return;
+	}
+
+	std::mutex l_mutex;
+	std::condition_variable l_cond;
+	std::atomic<std::size_t> l_next = 0;
+	std::atomic<bool> l_stop = false;
+	std::size_t l_done = 0;
+	std::size_t l_running = l_threads;
+	std::exception_ptr l_error;
+	range_pool::get().run(l_threads, [&]() {
+		for (std::size_t l_seg = l_next++; (l_seg < a_seg_count) && (!l_stop); l_seg = l_next++) {
+			std::exception_ptr l_caught;
+			try {
+				a_job(l_seg);
+			} catch (...) {
+				l_caught = std::current_exception();
+			}
+			std::lock_guard<std::mutex> l_guard(l_mutex);
+			if (l_caught) {
+				if (!l_error)
+					l_error = l_caught;
+				l_stop = true;
+			}
+			++l_done;
+			l_cond.notify_one();
+		}
+		std::lock_guard<std::mutex> l_guard(l_mutex);
+		--l_running;
+		l_cond.notify_one();
+	});
+
+	// everything above lives on this stack, so wait for every worker to be done with it before leaving
+	std::exception_ptr l_status_error;
+	std::size_t l_reported = 0;
+	{
+		std::unique_lock<std::mutex> l_ul(l_mutex);
+		while ((l_running > 0) || (l_reported < l_done)) {
+			l_cond.wait(l_ul, [&]() { return (l_done > l_reported) || (l_running == 0); });
+			std::size_t l_now = l_done;
+			if (l_status_error) {
+				l_reported = l_now;
+				continue;
+			}
+			l_ul.unlock();
+			try {
+				for (; l_reported < l_now; ++l_reported)
+					a_status_cb(l_reported, a_seg_count);
+			} catch (...) {
+				l_status_error = std::current_exception();
+				l_stop = true;
+				l_reported = l_now;
+			}
+			l_ul.lock();
+		}
+	}
+	if (l_error)
+		std::rethrow_exception(l_error);
+	if (l_status_error)
+		std::rethrow_exception(l_status_error);
+}
+
+ss::data data::range_encode_integer(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb, bool a_order1)
+{
+	// Format: cookie, 16 bit segment count, 40 bit message length, a 32 bit byte length for every segment so
+	// they can be found without parsing the ones before them, then the segments. Each segment is a 24 bit
+	// bitstream length, the frequency table padded to a whole byte (static model only), and the bitstream.
+	std::uint64_t l_message_len = a_data.size();
+	std::uint64_t l_seg_count = (l_message_len + m_seg_max - 1) / m_seg_max;
+	if (l_seg_count > 0xffff) {
+		data_exception e("range_encode: Buffer is too large to compress.");
+		throw (e);
+	}
+	std::vector<ss::data> l_segs(l_seg_count);
+	const std::uint8_t *l_in = a_data.contents().data();
+	range_run_segments(l_seg_count, [&](std::size_t l_seg) {
+		std::size_t l_segstart = l_seg * m_seg_max;
+		std::size_t l_segend = std::min<std::size_t>(l_segstart + m_seg_max, l_message_len);
+		if (a_order1)
+			l_segs[l_seg] = range_encode_segment_order1(l_in + l_segstart, l_segend - l_segstart);
+		else
+			l_segs[l_seg] = range_encode_segment(l_in + l_segstart, l_segend - l_segstart);
+	}, a_status_cb);
+
+	ss::data l_comp;
+	l_comp.set_network_byte_order(true);
+	l_comp.write_uint16(a_order1 ? m_cookie_o1 : m_cookie_int);
+	l_comp.write_uint16(l_seg_count);
+	l_comp.write_uint40(l_message_len);
+	for (ss::data& l_seg : l_segs)
+		l_comp.write_uint32(l_seg.size());
+	for (ss::data& l_seg : l_segs)
+		l_comp += l_seg;
+	return l_comp;
+}
+
+ss::data data::range_encode_segment(const std::uint8_t *a_in, std::size_t a_len)
+{
+	std::array<std::uint32_t, 256> l_counts = { };
+	for (std::size_t i = 0; i < a_len; ++i)
+		l_counts[a_in[i]]++;
+	std::array<std::uint32_t, 256> l_freqs;
+	range_normalize_counts(l_counts, a_len, l_freqs);
+	std::array<std::uint32_t, 256> l_cum;
+	std::uint32_t l_accumulator = 0;
+	for (std::size_t i = 0; i < 256; ++i) {
+		l_cum[i] = l_accumulator;
+		l_accumulator += l_freqs[i];
+	}
+
+	std::vector<std::uint8_t> l_bitstream;
+	l_bitstream.reserve(a_len / 2 + 16);
+	range_int_encoder l_coder(l_bitstream);
+	for (std::size_t i = 0; i < a_len; ++i)
+		l_coder.encode(l_coder.scale_pow2(m_int_total_bits), l_cum[a_in[i]], l_freqs[a_in[i]]);
+	l_coder.flush();
+
+	ss::data l_seg;
+	l_seg.set_network_byte_order(true);
+	l_seg.write_uint24(l_bitstream.size());
+	range_write_freq_table(l_seg, l_freqs);
+	l_seg.write_raw_data(l_bitstream);
+	return l_seg;
+}
+
+ss::data data::range_decode_integer(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb, bool a_order1)
+{
+	// cookie has already been read by range_decode_private
+	std::uint16_t l_seg_count = a_data.read_uint16();
+	std::uint64_t l_original_size = a_data.read_uint40();
+	if ((l_original_size > (std::uint64_t)l_seg_count * m_seg_max) || (l_original_size + m_seg_max <= (std::uint64_t)l_seg_count * m_seg_max)) {
+		data_exception e("range_decode: segment count doesn't match original size");
+		throw (e);
+	}
+	std::vector<std::size_t> l_seg_pos(l_seg_count + 1);
+	std::vector<std::size_t> l_seg_len(l_seg_count);
+	for (std::size_t l_seg = 0; l_seg < l_seg_count; ++l_seg)
+		l_seg_len[l_seg] = a_data.read_uint32();
+	l_seg_pos[0] = a_data.get_read_cursor();
+	for (std::size_t l_seg = 0; l_seg < l_seg_count; ++l_seg)
+		l_seg_pos[l_seg + 1] = l_seg_pos[l_seg] + l_seg_len[l_seg];
+	if (l_seg_pos[l_seg_count] > a_data.size()) {
+		data_exception e("range_decode: segment index runs past end of buffer");
+		throw (e);
+	}
+
+	ss::data l_ret;
+	l_ret.m_buffer.resize(l_original_size);
+	std::uint8_t *l_out = l_ret.m_buffer.data();
+	range_run_segments(l_seg_count, [&](std::size_t l_seg) {
+		std::size_t l_segstart = l_seg * m_seg_max;
+		std::size_t l_segend = std::min<std::size_t>(l_segstart + m_seg_max, l_original_size);
+		if (a_order1)
+			range_decode_segment_order1(a_data, l_seg_pos[l_seg], l_seg_len[l_seg], l_out + l_segstart, l_segend - l_segstart);
+		else
+			range_decode_segment(a_data, l_seg_pos[l_seg], l_seg_len[l_seg], l_out + l_segstart, l_segend - l_segstart);
+	}, a_status_cb);
+	a_data.set_read_cursor(l_seg_pos[l_seg_count]);
+	l_ret.m_write_cursor = l_original_size;
+	return l_ret;
+}
+
+void data::range_decode_segment(const ss::data& a_data, std::size_t a_pos, std::size_t a_len, std::uint8_t *a_out, std::size_t a_out_len)
+{
+	// only reads a_data's buffer, never its cursors, so segments of one buffer can be decoded at the same time
+	const std::uint8_t *l_seg = a_data.contents().data() + a_pos;
+	if (a_len < 3) {
+		data_exception e("range_decode: segment is truncated");
+		throw (e);
+	}
+	std::uint32_t l_bitstream_size = (l_seg[0] << 16) | (l_seg[1] << 8) | l_seg[2];
+
+	// read frequency table and build the cumulative table and the symbol lookup from it
+	ss::data::bit_cursor l_bitcursor;
+	l_bitcursor.byte = a_pos + 3;
+	ss::data::bit_reader l_reader(a_data, l_bitcursor);
+	std::array<std::uint32_t, 256> l_freqs;
+	range_read_freq_table(l_reader, l_freqs);
+	std::size_t l_bitstream_start = l_reader.get_bit_cursor().byte;
+	std::array<std::uint32_t, 256> l_cum;
+	std::vector<std::uint8_t> l_lookup(1 << m_int_total_bits);
+	std::uint32_t l_accumulator = 0;
+	for (std::size_t i = 0; i < 256; ++i) {
+		l_cum[i] = l_accumulator;
+		if (l_accumulator + l_freqs[i] > (1U << m_int_total_bits))
+			break;
+		std::fill(l_lookup.begin() + l_accumulator, l_lookup.begin() + l_accumulator + l_freqs[i], i);
+		l_accumulator += l_freqs[i];
+	}
+	if (l_accumulator != (1U << m_int_total_bits)) {
+		data_exception e("range_decode: frequency table is invalid");
+		throw (e);
+	}
+	if (l_bitstream_start + l_bitstream_size != a_pos + a_len) {
+		data_exception e("range_decode: segment length doesn't match bitstream");
+		throw (e);
+	}
+
+	// decode
+	range_int_decoder l_coder(a_data.contents().data() + l_bitstream_start, l_bitstream_size);
+	for (std::size_t i = 0; i < a_out_len; ++i) {
+		std::uint32_t l_r = l_coder.scale_pow2(m_int_total_bits);
+		std::uint32_t l_value = l_coder.value(l_r);
+		if (l_value >= (1U << m_int_total_bits)) {
+			data_exception e("range_decode: bitstream is corrupt");
+			throw (e);
+		}
+		std::uint8_t l_symbol = l_lookup[l_value];
+		a_out[i] = l_symbol;
+		l_coder.decode(l_r, l_cum[l_symbol], l_freqs[l_symbol]);
+	}
+}
+
+// Adaptive order-1 model: a frequency table for each previous byte, with a Fenwick tree over each table so
+// cumulative frequencies and symbol lookups take 8 steps instead of a scan of 256 entries.
+class range_order1_model {
+public:
+	const static std::uint32_t INCREMENT = 24;
+	const static std::uint32_t LIMIT = 1 << 16; // tables are halved when their total passes this
+
+	range_order1_model()
+	: m_freq(256 * 256, 1)
+	, m_tree(256 * 257)
+	, m_total(256, 256)
+	{
+		for (std::size_t l_ctx = 0; l_ctx < 256; ++l_ctx)
+			rebuild(l_ctx);
+	}
+
+	std::uint32_t total(std::uint8_t a_ctx) const { return m_total[a_ctx]; }
+	std::uint32_t freq(std::uint8_t a_ctx, std::uint8_t a_sym) const { return m_freq[(a_ctx << 8) | a_sym]; }
+
+	// sum of the frequencies of every symbol below a_sym
+	std::uint32_t cum(std::uint8_t a_ctx, std::uint8_t a_sym) const
+	{
+		const std::uint32_t *l_tree = &m_tree[a_ctx * 257];
+		std::uint32_t l_sum = 0;
+		for (std::uint32_t i = a_sym; i > 0; i -= (i & -i))
+			l_sum += l_tree[i];
+		return l_sum;
+	}
+
+	// symbol whose cumulative range holds a_value
+	std::uint8_t find(std::uint8_t a_ctx, std::uint32_t a_value) const
+	{
+		const std::uint32_t *l_tree = &m_tree[a_ctx * 257];
+		std::uint32_t l_pos = 0;
+		for (std::uint32_t l_step = 256; l_step > 0; l_step >>= 1) {
+			if ((l_pos + l_step <= 256) && (l_tree[l_pos + l_step] <= a_value)) {
+				l_pos += l_step;
+				a_value -= l_tree[l_pos];
+			}
+		}
+		return l_pos;
+	}
+
+	void update(std::uint8_t a_ctx, std::uint8_t a_sym)
+	{
+		m_freq[(a_ctx << 8) | a_sym] += INCREMENT;
+		m_total[a_ctx] += INCREMENT;
+		if (m_total[a_ctx] > LIMIT) {
+			m_total[a_ctx] = 0;
+			for (std::size_t i = 0; i < 256; ++i) {
+				std::uint16_t& l_freq = m_freq[(a_ctx << 8) | i];
+				l_freq = (l_freq + 1) >> 1;
+				m_total[a_ctx] += l_freq;
+			}
+			rebuild(a_ctx);
+			return;
+		}
+		std::uint32_t *l_tree = &m_tree[a_ctx * 257];
+		for (std::uint32_t i = a_sym + 1; i <= 256; i += (i & -i))
+			l_tree[i] += INCREMENT;
+	}
+
+protected:
+	void rebuild(std::size_t a_ctx)
+	{
+		std::uint32_t *l_tree = &m_tree[a_ctx * 257];
+		l_tree[0] = 0;
+		for (std::uint32_t i = 1; i <= 256; ++i)
+			l_tree[i] = m_freq[(a_ctx << 8) | (i - 1)];
+		for (std::uint32_t i = 1; i <= 256; ++i) {
+			std::uint32_t l_parent = i + (i & -i);
+			if (l_parent <= 256)
+				l_tree[l_parent] += l_tree[i];
+		}
+	}
+
+	std::vector<std::uint16_t> m_freq;
+	std::vector<std::uint32_t> m_tree; // 1-based Fenwick tree per context, 257 entries apiece
+	std::vector<std::uint32_t> m_total;
+};
+
+ss::data data::range_encode_segment_order1(const std::uint8_t *a_in, std::size_t a_len)
+{
+	// segment record is a 24 bit bitstream length and the bitstream; the model starts fresh in every segment
+	std::vector<std::uint8_t> l_bitstream;
+	l_bitstream.reserve(a_len / 2 + 16);
+	range_int_encoder l_coder(l_bitstream);
+	range_order1_model l_model;
+	std::uint8_t l_ctx = 0;
+	for (std::size_t i = 0; i < a_len; ++i) {
+		std::uint8_t l_sym = a_in[i];
+		l_coder.encode(l_coder.scale(l_model.total(l_ctx)), l_model.cum(l_ctx, l_sym), l_model.freq(l_ctx, l_sym));
+		l_model.update(l_ctx, l_sym);
+		l_ctx = l_sym;
+	}
+	l_coder.flush();
+
+	ss::data l_seg;
+	l_seg.set_network_byte_order(true);
+	l_seg.write_uint24(l_bitstream.size());
+	l_seg.write_raw_data(l_bitstream);
+	return l_seg;
+}
+
+void data::range_decode_segment_order1(const ss::data& a_data, std::size_t a_pos, std::size_t a_len, std::uint8_t *a_out, std::size_t a_out_len)
+{
+	const std::uint8_t *l_seg = a_data.contents().data() + a_pos;
+	if (a_len < 3) {
+		data_exception e("range_decode: segment is truncated");
+		throw (e);
+	}
+	std::uint32_t l_bitstream_size = (l_seg[0] << 16) | (l_seg[1] << 8) | l_seg[2];
+	if (l_bitstream_size + 3 != a_len) {
+		data_exception e("range_decode: segment length doesn't match bitstream");
+		throw (e);
+	}
+
+	range_int_decoder l_coder(l_seg + 3, l_bitstream_size);
+	range_order1_model l_model;
+	std::uint8_t l_ctx = 0;
+	for (std::size_t i = 0; i < a_out_len; ++i) {
+		std::uint32_t l_total = l_model.total(l_ctx);
+		std::uint32_t l_r = l_coder.scale(l_total);
+		std::uint32_t l_value = l_coder.value(l_r);
+		if (l_value >= l_total) {
+			data_exception e("range_decode: bitstream is corrupt");
+			throw (e);
+		}
+		std::uint8_t l_sym = l_model.find(l_ctx, l_value);
+		a_out[i] = l_sym;
+		l_coder.decode(l_r, l_model.cum(l_ctx, l_sym), l_model.freq(l_ctx, l_sym));
+		l_model.update(l_ctx, l_sym);
+		l_ctx = l_sym;
+	}
+}
+
+/* streaming range coder */
+
+// Stream format: cookie, then one frame per segment: 24 bit segment length (before coding), 32 bit record
+// length, and the segment record as written by range_encode_segment. A segment length of 0 ends the stream.
+const std::uint16_t m_cookie_stream = 0xaa1e;
+
+data::range_stream_encoder::range_stream_encoder(std::size_t a_window)
+: m_window(std::max<std::size_t>(a_window / m_seg_max, 1) * m_seg_max)
+{
+	m_out.push_back(m_cookie_stream >> 8);
+	m_out.push_back(m_cookie_stream & 0xff);
+}
+
+void data::range_stream_encoder::push(const std::uint8_t *a_in, std::size_t a_len)
+{
+	// feed the RLE encoder a window at a time so m_pending never grows much past the window
+	for (std::size_t l_pos = 0; l_pos < a_len; l_pos += m_window) {
+		m_rle.push(a_in + l_pos, std::min(m_window, a_len - l_pos));
+		data l_rle = m_rle.pull();
+		m_pending.insert(m_pending.end(), l_rle.m_buffer.begin(), l_rle.m_buffer.end());
+		if (m_pending.size() >= m_window)
+			encode_segments(m_pending.size() - (m_pending.size() % m_seg_max));
+	}
+}
+
+void data::range_stream_encoder::finish()
+{
+	m_rle.finish();
+	data l_rle = m_rle.pull();
+	m_pending.insert(m_pending.end(), l_rle.m_buffer.begin(), l_rle.m_buffer.end());
+	encode_segments(m_pending.size());
+	m_out.insert(m_out.end(), { 0, 0, 0 });
+}
+
+void data::range_stream_encoder::encode_segments(std::size_t a_len)
+{
+	std::size_t l_seg_count = (a_len + m_seg_max - 1) / m_seg_max;
+	std::vector<ss::data> l_segs(l_seg_count);
+	range_run_segments(l_seg_count, [&](std::size_t l_seg) {
+		std::size_t l_segstart = l_seg * m_seg_max;
+		l_segs[l_seg] = range_encode_segment(m_pending.data() + l_segstart, std::min<std::size_t>(m_seg_max, a_len - l_segstart));
+	}, default_predicate);
+	for (std::size_t l_seg = 0; l_seg < l_seg_count; ++l_seg) {
+		std::size_t l_seglen = std::min<std::size_t>(m_seg_max, a_len - l_seg * m_seg_max);
+		std::size_t l_reclen = l_segs[l_seg].size();
+		m_out.insert(m_out.end(), { (std::uint8_t)(l_seglen >> 16), (std::uint8_t)(l_seglen >> 8), (std::uint8_t)l_seglen });
+		m_out.insert(m_out.end(), { (std::uint8_t)(l_reclen >> 24), (std::uint8_t)(l_reclen >> 16), (std::uint8_t)(l_reclen >> 8), (std::uint8_t)l_reclen });
+		m_out.insert(m_out.end(), l_segs[l_seg].m_buffer.begin(), l_segs[l_seg].m_buffer.end());
+	}
+	m_pending.erase(m_pending.begin(), m_pending.begin() + a_len);
+}
+
+data::range_stream_decoder::range_stream_decoder()
+: m_have_cookie(false)
+, m_done(false)
+{
+}
+
+void data::range_stream_decoder::push(const std::uint8_t *a_in, std::size_t a_len)
+{
+	if ((m_done) && (a_len > 0)) {
+		data_exception e("range_stream_decoder: data past end of stream");
+		throw (e);
+	}
+	m_in.m_buffer.insert(m_in.m_buffer.end(), a_in, a_in + a_len);
+	decode_segments();
+}
+
+void data::range_stream_decoder::finish()
+{
+	decode_segments();
+	if (!m_done) {
+		data_exception e("range_stream_decoder: stream is truncated");
+		throw (e);
+	}
+	m_rle.finish();
+}
+
+void data::range_stream_decoder::decode_segments()
+{
+	const std::uint8_t *l_in = m_in.m_buffer.data();
+	std::size_t l_avail = m_in.m_buffer.size();
+	std::size_t l_pos = 0;
+	if (!m_have_cookie) {
+		if (l_avail < 2)
+			return;
+		if (((l_in[0] << 8) | l_in[1]) != m_cookie_stream) {
+			data_exception e("range_stream_decoder: cookie mismatch");
+			throw (e);
+		}
+		m_have_cookie = true;
+		l_pos = 2;
+	}
+
+	// find every whole frame we have so far
+	std::vector<std::size_t> l_rec_pos, l_rec_len, l_seg_len;
+	std::size_t l_total = 0;
+	while ((!m_done) && (l_avail - l_pos >= 3)) {
+		std::size_t l_seglen = (l_in[l_pos] << 16) | (l_in[l_pos + 1] << 8) | l_in[l_pos + 2];
+		if (l_seglen == 0) {
+			m_done = true;
+			l_pos += 3;
+			break;
+		}
+		if (l_seglen > m_seg_max) {
+			data_exception e("range_stream_decoder: segment length is invalid");
+			throw (e);
+		}
+		if (l_avail - l_pos < 7)
+			break;
+		std::size_t l_reclen = ((std::size_t)l_in[l_pos + 3] << 24) | (l_in[l_pos + 4] << 16) | (l_in[l_pos + 5] << 8) | l_in[l_pos + 6];
+		if (l_avail - l_pos - 7 < l_reclen)
+			break;
+		l_rec_pos.push_back(l_pos + 7);
+		l_rec_len.push_back(l_reclen);
+		l_seg_len.push_back(l_seglen);
+		l_total += l_seglen;
+		l_pos += 7 + l_reclen;
+	}
+	if ((m_done) && (l_pos < l_avail)) {
+		data_exception e("range_stream_decoder: data past end of stream");
+		throw (e);
+	}
+
+	std::vector<std::uint8_t> l_rle(l_total);
+	std::vector<std::size_t> l_out_pos(l_seg_len.size() + 1, 0);
+	for (std::size_t l_seg = 0; l_seg < l_seg_len.size(); ++l_seg)
+		l_out_pos[l_seg + 1] = l_out_pos[l_seg] + l_seg_len[l_seg];
+	range_run_segments(l_seg_len.size(), [&](std::size_t l_seg) {
+		range_decode_segment(m_in, l_rec_pos[l_seg], l_rec_len[l_seg], l_rle.data() + l_out_pos[l_seg], l_seg_len[l_seg]);
+	}, default_predicate);
+	m_rle.push(l_rle.data(), l_rle.size());
+	data l_decoded = m_rle.pull();
+	m_out.insert(m_out.end(), l_decoded.m_buffer.begin(), l_decoded.m_buffer.end());
+	m_in.m_buffer.erase(m_in.m_buffer.begin(), m_in.m_buffer.begin() + l_pos);
+}
+
+void data::stream_file(const std::string& a_in_filename, const std::string& a_out_filename, stream_codec& a_codec, std::size_t a_window)
+{
+	std::ifstream l_infile;
+	l_infile.open(a_in_filename.c_str(), std::ios::binary);
+	if (!l_infile.is_open()) {
+		data_exception e("stream_file: unable to open input file.");
+		throw(e);
+	}
+	std::ofstream l_outfile;
+	l_outfile.open(a_out_filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!l_outfile.is_open()) {
+		data_exception e("stream_file: unable to open output file.");
+		throw(e);
+	}
+
+	auto write_pending = [&]() {
+		data l_chunk = a_codec.pull();
+		l_outfile.write((char *)l_chunk.m_buffer.data(), l_chunk.m_buffer.size());
+		if (!l_outfile.good()) {
+			data_exception e("stream_file: unable to write to output file.");
+			throw(e);
+		}
+	};
+	std::vector<char> l_buff(std::max<std::size_t>(a_window, 1));
+	do {
+		l_infile.read(l_buff.data(), l_buff.size());
+		if (l_infile.bad()) {
+			data_exception e("stream_file: unable to read input file.");
+			throw(e);
+		}
+		a_codec.push((std::uint8_t *)l_buff.data(), l_infile.gcount());
+		write_pending();
+	} while (!l_infile.eof());
+	a_codec.finish();
+	write_pending();
+}
+
+/* views */
+
+data_view data::view() const
+{
+	return data_view(*this);
+}
+
+data_view data::view(std::size_t a_offset, std::size_t a_len) const
+{
+	return data_view(*this).subview(a_offset, a_len);
+}
+
+data_view::data_view()
+: m_buffer(nullptr)
+, m_len(0)
+, m_read_cursor(0)
+, m_network_byte_order(false)
+, m_delimiter(0xa)
+{
+}
+
+data_view::data_view(const std::uint8_t *a_buffer, std::size_t a_len)
+: m_buffer(a_buffer)
+, m_len(a_len)
+, m_read_cursor(0)
+, m_network_byte_order(false)
+, m_delimiter(0xa)
+{
+}
+
+data_view::data_view(const data& a_data)
+: data_view(a_data.contents())
+{
+	m_network_byte_order = a_data.m_network_byte_order;
+	m_delimiter = a_data.m_delimiter;
+}
+
+data_view data_view::subview(std::size_t a_offset, std::size_t a_len) const
+{
+	if ((a_offset > m_len) || (a_len > m_len - a_offset)) {
+		data_exception e("data_view::subview: range is past end of buffer.");
+		throw (e);
+	}
+	data_view l_ret(m_buffer + a_offset, a_len);
+	l_ret.m_network_byte_order = m_network_byte_order;
+	l_ret.m_delimiter = m_delimiter;
+	return l_ret;
+}
+
+data data_view::to_data() const
+{
+	data l_ret;
+	l_ret.set_network_byte_order(m_network_byte_order);
+	l_ret.set_delimiter(m_delimiter);
+	l_ret.write_bytes(m_buffer, m_len);
+	return l_ret;
+}
+
+void data_view::set_read_cursor(std::size_t a_read_cursor)
+{
+	if (a_read_cursor > m_len) {
+		data_exception e("attempt to set read cursor past end of buffer.");
+		throw (e);
+	}
+	m_read_cursor = a_read_cursor;
+}
+
+void data_view::set_read_bit_cursor(data::bit_cursor a_bit_cursor)
+{
+	if ((a_bit_cursor.byte < m_len) || ((a_bit_cursor.byte == m_len) && (a_bit_cursor.bit == 7))) {
+		m_read_bit_cursor = a_bit_cursor;
+	} else {
+		data_exception e("attempt to set read bit cursor past end of buffer.");
+		throw (e);
+	}
+}
+
+std::uint64_t data_view::read_bits(std::uint16_t a_count)
+{
+	data::bit_reader l_reader(span(), m_read_bit_cursor);
+	std::uint64_t l_ret = l_reader.read_bits(a_count);
+	m_read_bit_cursor = l_reader.get_bit_cursor();
+	return l_ret;
+}
+
+const std::uint8_t *data_view::take(std::size_t a_len)
+{
+	if (a_len > m_len - m_read_cursor) {
+		data_exception e("attempt to read past end of buffer.");
+		throw (e);
+	}
+	const std::uint8_t *l_ret = m_buffer + m_read_cursor;
+	m_read_cursor += a_len;
+	return l_ret;
+}
+
+std::uint8_t data_view::read_uint8()
+{
+	return *take(1);
+}
+
+std::uint64_t data_view::read_narrow(std::size_t a_num_bytes, bool a_signed)
+{
+	return data::narrow_value(take(a_num_bytes), a_num_bytes, (std::endian::native == std::endian::big) || m_network_byte_order, a_signed);
+}
+
+long double data_view::read_longdouble()
+{
+	long double l_ret;
+	memcpy(&l_ret, take(sizeof(long double)), sizeof(long double));
+	return l_ret;
+}
+
+data_view data_view::read_view(std::size_t a_len)
+{
+	const std::uint8_t *l_start = take(a_len);
+	return subview(l_start - m_buffer, a_len);
+}
+
+std::string_view data_view::read_string_view(std::size_t a_len)
+{
+	return std::string_view((const char *)take(a_len), a_len);
+}
+
+std::optional<std::string_view> data_view::read_string_view_delim()
+{
+	if (m_read_cursor == m_len)
+		return std::nullopt;
+	const std::uint8_t *l_start = m_buffer + m_read_cursor;
+	const std::uint8_t *l_delim = (const std::uint8_t *)memchr(l_start, m_delimiter, m_len - m_read_cursor);
+	if (!l_delim)
+		return std::nullopt;
+	m_read_cursor += (l_delim - l_start) + 1;
+	return std::string_view((const char *)l_start, l_delim - l_start);
+}
+
+std::optional<std::string> data_view::read_std_str_delim()
+{
+	std::optional<std::string_view> l_ret = read_string_view_delim();
+	if (!l_ret)
+		return std::nullopt;
+	return std::string(*l_ret);
+}
+
+std::string data_view::read_hex_str(std::size_t a_len)
+{
+	return data::hex_str(take(a_len), a_len);
+}
+
+std::string data_view::read_base64(std::size_t a_len)
+{
+	return data::base64_str(take(a_len), a_len);
+}
+
 };
 
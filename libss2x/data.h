@@ -12,19 +12,27 @@
 #include <deque>
 #include <map>
 #include <stack>
+#include <queue>
 #include <exception>
+#include <stdexcept>
 #include <array>
 #include <bit>
 #include <algorithm>
 #include <random>
 #include <optional>
 #include <functional>
+#include <span>
+#include <string_view>
 
 #include <climits>
 #include <cstdint>
 
 #include <memory.h>
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "bf.h"
 #include "md5.h"
@@ -32,6 +40,8 @@
 #include "sha2.h"
 #include "hmac.h"
 #include "aes.h"
+#include "aesni.h"
+#include "sha256mb.h"
 
 namespace ss {
 
@@ -46,36 +56,14 @@ protected:
 	std::string m_what; // Error string.
 };
 
+class data_view;
+
 class data {
 
 	const static std::uint32_t crc32_tab[];
+	static const std::array<std::array<std::uint32_t, 256>, 8>& crc32_slice_tab(); // slicing-by-8 tables built from crc32_tab
 	const static std::uint8_t byte_mask[];
 
-	typedef union {
-		std::uint8_t uint8_val;
-		std::int8_t int8_val;
-	} size1_union;
-
-	typedef union {
-		std::uint16_t uint16_val;
-		std::int16_t int16_val;
-		std::uint8_t raw[2];
-	} size2_union;
-
-	typedef union {
-		std::uint32_t uint32_val;
-		std::int32_t int32_val;
-		float float_val;
-		std::uint8_t raw[4];
-	} size4_union;
-
-	typedef union {
-		std::uint64_t uint64_val;
-		std::int64_t int64_val;
-		double double_val;
-		std::uint8_t raw[8];
-	} size8_union;
-	
 	typedef union {
 		long double longdouble_val;
 		std::uint8_t raw[16];
@@ -83,6 +71,25 @@ class data {
 
 	std::vector<std::uint8_t> read_raw_data(std::size_t a_num_bytes);
 	void write_raw_data(const std::vector<std::uint8_t>& a_vector);
+	// what the scalar read_* and write_* methods are built on; they copy straight to and from m_buffer
+	void write_bytes(const void *a_src, std::size_t a_num_bytes);
+	void read_bytes(void *a_dest, std::size_t a_num_bytes);
+	template <typename T> void write_scalar(T a_val); // integers, swapped for network byte order
+	template <typename T> T read_scalar();
+	void write_narrow(std::uint64_t a_val, std::size_t a_num_bytes); // the 24, 40 and 48 bit integers
+	std::uint64_t read_narrow(std::size_t a_num_bytes, bool a_signed);
+	static std::uint64_t narrow_value(const std::uint8_t *a_raw, std::size_t a_num_bytes, bool a_big, bool a_signed);
+	// circular mode ring: m_ring_size unread bytes from m_ring_head, wrapping at the end of m_buffer
+	void ring_reserve(std::size_t a_size);
+	void ring_unwrap() const; // so the unread bytes don't wrap
+	// what the object holds: the buffer, or in circular mode the unread bytes of the ring
+	std::span<const std::uint8_t> contents() const;
+	void no_circular_mode(const char *a_what) const; // throws in circular mode
+	void ring_peek(std::uint8_t *a_dest, std::size_t a_offset, std::size_t a_len) const;
+	void ring_write(const std::uint8_t *a_src, std::size_t a_len);
+	void ring_read(std::uint8_t *a_dest, std::size_t a_len);
+	void ring_consume(std::size_t a_len);
+	std::size_t ring_index(std::size_t a_index) const { return (m_ring_head + a_index) & (m_buffer.size() - 1); }
 	
 	//static private utility methods for textual presentation and initialization
 	static std::string hex_str(const std::uint8_t *a_data, std::size_t a_len);
@@ -91,12 +98,24 @@ class data {
 	static std::uint8_t *base64_decode(const std::string a_str, std::size_t *decode_len);
 	
 	void copy_construct(const data& a_data);
+	void move_construct(data& a_data); // takes the buffer and leaves a_data empty
 
 	// private ranger routines
-	void assign_ranges(std::uint64_t a_lo, std::uint64_t a_hi);
+	class range_context; // per-call coder model, defined in data.cc so range_encode/range_decode share no state
 	static void default_predicate(std::uint64_t a_num, std::uint64_t a_denom);
 	ss::data range_encode_private(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb = default_predicate);
 	ss::data range_decode_private(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb = default_predicate);
+	ss::data range_encode_integer(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb, bool a_order1);
+	ss::data range_decode_integer(ss::data& a_data, std::function<void(std::uint64_t, std::uint64_t)> a_status_cb, bool a_order1);
+	static ss::data range_encode_segment(const std::uint8_t *a_in, std::size_t a_len);
+	static void range_decode_segment(const ss::data& a_data, std::size_t a_pos, std::size_t a_len, std::uint8_t *a_out, std::size_t a_out_len);
+	static ss::data range_encode_segment_order1(const std::uint8_t *a_in, std::size_t a_len);
+	static void range_decode_segment_order1(const ss::data& a_data, std::size_t a_pos, std::size_t a_len, std::uint8_t *a_out, std::size_t a_out_len);
+
+	// the *_cbc_hmac_sha2_256 pipelines, shared by every cipher. a_cbc runs the cipher's CBC mode over whole
+	// blocks in place and carries its chaining value from one call to the next; a_cipher names it in errors.
+	static data cbc_hmac_seal(const std::uint8_t *a_key, std::size_t a_key_len, const data& a_data, std::size_t a_block, const std::function<void(std::uint8_t *, std::size_t)>& a_cbc);
+	static data cbc_hmac_open(const std::uint8_t *a_key, std::size_t a_key_len, const data& a_data, std::size_t a_block, const std::function<void(std::uint8_t *, std::size_t)>& a_cbc, const std::string& a_cipher);
 
 public:
 
@@ -108,7 +127,53 @@ public:
 		std::uint16_t bit;
 		void set_absolute(std::uint64_t a_absolute); // lower 64 bits of absolute bit position
 		void advance_to_next_whole_byte() { if (bit < 7) { ++byte; bit = 7; } }
-		std::uint64_t get_absolute();
+		std::uint64_t get_absolute() const;
+	};
+
+	/* buffered bit streams */
+
+	// bit_writer keeps up to 64 pending bits in an accumulator and commits them to the
+	// buffer a whole byte group at a time. It starts at the data object's write bit cursor
+	// and moves that cursor along when flushed (and on destruction). Don't mix calls to
+	// the data object's own bit routines with a live bit_writer on the same object.
+	class bit_writer {
+	public:
+		bit_writer(data& a_data);
+		bit_writer(const bit_writer& a_writer) = delete;
+		~bit_writer();
+		void write_bits(std::uint64_t a_bits, std::uint16_t a_count);
+		void write_bit(bool a_bit) { write_bits(a_bit ? 1 : 0, 1); }
+		void advance_to_next_whole_byte();
+		void flush(); // commit partial byte and update the data object's write bit cursor
+		bit_cursor get_bit_cursor() const;
+	protected:
+		void drain();
+		data& m_data;
+		std::uint64_t m_accum; // pending bits, left justified
+		std::uint16_t m_count; // number of pending bits in m_accum
+		std::uint64_t m_byte; // buffer position of the first pending bit
+	};
+
+	// bit_reader refills a 64-bit accumulator from the buffer up to 8 bytes at a time.
+	// It never touches the data object's cursors; use get_bit_cursor() to find out where it stopped.
+	// Don't write to the data object while a bit_reader is reading it.
+	class bit_reader {
+	public:
+		bit_reader(const data& a_data, bit_cursor a_start = bit_cursor());
+		bit_reader(std::span<const std::uint8_t> a_buffer, bit_cursor a_start = bit_cursor());
+		std::uint64_t read_bits(std::uint16_t a_count);
+		bool read_bit() { return read_bits(1) > 0; }
+		std::uint64_t peek_bits(std::uint16_t a_count); // up to 56 bits, zero filled past end of buffer
+		void skip_bits(std::uint16_t a_count);
+		void advance_to_next_whole_byte();
+		bit_cursor get_bit_cursor() const;
+	protected:
+		void refill();
+		const std::uint8_t *m_buffer;
+		std::uint64_t m_size;
+		std::uint64_t m_accum; // unread bits, left justified
+		std::uint16_t m_count; // number of valid bits in m_accum
+		std::uint64_t m_byte; // next buffer position to load into m_accum
 	};
 
 	/* huffman related */
@@ -126,13 +191,27 @@ public:
 		bool operator<(const huff_tree_node& rhs) const { return (freq < rhs.freq); }
 	};
 
-	const static uint32_t HUFF_MAGIC_COOKIE = 0xc0edbabe;
+	static constexpr uint32_t HUFF_MAGIC_COOKIE = 0xc0edbabe; // legacy format, frequency table header
+	static constexpr uint32_t HUFF_CANONICAL_MAGIC_COOKIE = 0xc0edcafe; // canonical format, code length header
+	static constexpr std::uint16_t HUFF_MAX_CODE_LEN = 24; // canonical code lengths are limited to this
+	static constexpr std::uint16_t HUFF_TABLE_BITS = 11; // width of the canonical decoder's primary lookup table
+
+	/* LZ related */
+
+	enum lz_backend { LZ_RAW = 0, LZ_HUFFMAN = 1, LZ_RANGE = 2 }; // entropy coder run over the LZ token stream
+	static constexpr std::uint32_t LZ_MAGIC_COOKIE = 0xc0ed1277;
+	static constexpr std::size_t LZ_MAX_OFFSET = 65535; // matches are found up to this far back
+	static constexpr std::size_t LZ_MIN_MATCH = 3;
+	static constexpr std::size_t LZ_MAX_MATCH = 258; // length is stored as a byte, less LZ_MIN_MATCH
+	static constexpr std::uint16_t LZ_HASH_BITS = 15; // width of the hash of the next LZ_MIN_MATCH bytes
+	static constexpr std::size_t LZ_MAX_CHAIN = 64; // how many earlier positions with the same hash to try
+	static constexpr std::size_t LZ_LAZY_LIMIT = 32; // matches at least this long are taken without looking one byte ahead
 
 	/* constructors */
 	
 	data();
 	data(const data& a_data);
-	data(data&& a_data);
+	data(data&& a_data) noexcept; // leaves a_data empty
 	~data();
 	
 	void dump_hex() const;
@@ -142,7 +221,9 @@ public:
 	/* files */
 	
 	void save_file(const std::string& a_filename);
-	void load_file(const std::string& a_filename);
+	void load_file(const std::string& a_filename); // appends at the write cursor
+	// a file mapped into memory instead of read into a buffer
+	class mapped_file;
 
 	/* cursor management/settings */
 	
@@ -150,13 +231,27 @@ public:
 	void set_write_cursor_to_append();
 	void set_read_cursor(std::size_t a_read_cursor);
 	void set_network_byte_order(bool a_setting) { m_network_byte_order = a_setting; };
-	void set_circular_mode(bool a_setting) { m_circular_mode = a_setting; };
+	// Circular mode makes the object a FIFO: writes append, reads consume from the front. The bytes live in a
+	// ring (power of two capacity, grown as needed) so reading never shifts what's left. Everything that looks
+	// at the whole buffer (hashing, encryption, compression, save_file(), views and so on) sees the unread
+	// bytes, unwrapping the ring first if they wrap around its end, so don't share a circular object between
+	// threads even just to read it. Writing bits and the in place encryption functions throw in circular mode.
+	// Turning it off leaves the unread bytes in an ordinary buffer.
+	void set_circular_mode(bool a_setting);
 	
 	std::size_t get_write_cursor() { return m_write_cursor; };
 	std::size_t get_read_cursor() { return m_read_cursor; };
 	bool get_network_byte_order() { return m_network_byte_order; };
 	bool get_circular_mode() { return m_circular_mode; };
 	std::size_t size() const;
+	// circular mode, without copying: circular_readable() is the unread bytes up to where the ring wraps, and
+	// circular_linearize() moves them so none wrap first. circular_writable() is free space after the last
+	// byte, at least a_min of it (the ring grows if needed); fill some of it, e.g. from a socket, then
+	// circular_commit() that many bytes. Consume with the read methods or truncate_front().
+	std::span<const std::uint8_t> circular_readable() const;
+	std::span<const std::uint8_t> circular_linearize();
+	std::span<std::uint8_t> circular_writable(std::size_t a_min = 1);
+	void circular_commit(std::size_t a_num_bytes);
 
 	/* utilities */
 	
@@ -165,10 +260,20 @@ public:
 	void clear();
 	void truncate_back(std::size_t a_new_len);
 	void truncate_front(std::size_t a_trunc_len);
-	void assign(const std::uint8_t *a_buffer, std::size_t a_len);
-	std::uint8_t *buffer() { return m_buffer.data(); }
+	void assign(const std::uint8_t *a_buffer, std::size_t a_len); // at the write cursor, like write_raw_data
+	void append(const std::uint8_t *a_buffer, std::size_t a_len); // at the end, wherever the write cursor is
+	// reserve() ahead of writes whose total size is known, so the buffer grows once. In circular mode these
+	// size the ring, and capacity() is how many bytes it holds before it has to grow.
+	void reserve(std::size_t a_capacity);
+	std::size_t capacity() const;
+	void shrink_to_fit();
+	std::uint8_t *buffer(); // size() bytes; in circular mode the unread bytes, unwrapped
+	// read without copying; the view is only good until the buffer is next written to (or the ring unwrapped)
+	data_view view() const;
+	data_view view(std::size_t a_offset, std::size_t a_len) const;
 	bool compare(const data& a_data) const; // true = same, false = different
 	void append_data(const data& a_data);
+	void append_data(data&& a_data); // takes a_data's buffer rather than copying it when this one is empty
 	
 	/* operators */
 	
@@ -178,6 +283,7 @@ public:
 	data& operator=(const data& a_data);
 	data& operator=(data&& a_data);
 	data& operator+=(const data& a_data);
+	data& operator+=(data&& a_data);
 	std::uint8_t& operator[](std::size_t index);
 
 	/* bits */
@@ -269,13 +375,29 @@ public:
 
 	/* hashing */
 	
-	std::uint32_t crc32(std::uint32_t a_crc);
-	data md5();
-	data sha1();
-	data sha2_224();
-	data sha2_256();
-	data sha2_384();
-	data sha2_512();
+	// chain calls by passing the previous result as a_crc to checksum data that arrives in pieces
+	std::uint32_t crc32(std::uint32_t a_crc) const;
+	std::uint32_t crc32_range(std::uint32_t a_crc, std::size_t a_offset, std::size_t a_len) const; // doesn't touch cursors
+	static std::uint32_t crc32(std::uint32_t a_crc, const std::uint8_t *a_data, std::size_t a_len);
+	data md5() const;
+	data sha1() const;
+	data sha2_224() const;
+	data sha2_256() const;
+	data sha2_384() const;
+	data sha2_512() const;
+	// incremental hashing: feed a hasher as much or as little at a time as is convenient
+	enum hash_type { HASH_MD5 = 0, HASH_SHA1 = 1, HASH_SHA2_224 = 2, HASH_SHA2_256 = 3, HASH_SHA2_384 = 4, HASH_SHA2_512 = 5 };
+	class hasher;
+	// hash a file a_chunk bytes at a time without loading it
+	static data hash_file(const std::string& a_filename, hash_type a_type, std::size_t a_chunk = STREAM_WINDOW);
+	// HMAC with one of the SHA-2 hashes; build an hmac_context once per key when there are many messages
+	class hmac_context;
+	static data hmac(const data& a_key, const data& a_message, hash_type a_type = HASH_SHA2_256);
+	// SHA-256 and HMAC-SHA256 (same digests as hmacsha256() in hmac.c) of many independent messages at once,
+	// through the SHA extensions or eight messages to the AVX2 registers when the CPU has them
+	static std::vector<data> sha2_256_batch(const std::vector<data>& a_messages);
+	static std::vector<data> hmac_sha2_256_batch(const data& a_key, const std::vector<data>& a_messages);
+	static std::vector<data> hmac_sha2_256_batch(const hmac_context& a_key, const std::vector<data>& a_messages);
 	
 	/* encryption */
 	
@@ -286,7 +408,14 @@ public:
 	static data bf_block_encrypt(data& a_block, data& a_key);
 	static data bf_block_decrypt(data& a_block, data& a_key);
 	static data bf_encrypt_with_cbc(data& a_data, data& a_key, data& a_iv); // raw encryption/decryption to satisfy test vectors
-	static data bf_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv);
+	// CBC decryption of 4MB or more can be split across a_threads threads; the default stays serial, 0 is one per core
+	static data bf_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv, std::size_t a_threads = 1);
+	// in place: encrypting zero pads a_data out to the block size, and both leave the cursors as on a fresh result
+	static void bf_encrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv);
+	static void bf_decrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv, std::size_t a_threads = 1);
+	// caller owned memory, a whole number of blocks long
+	static void bf_encrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv);
+	static void bf_decrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv, std::size_t a_threads = 1);
 	static data encrypt_bf_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv); // use these for encrypting production data
 	static data decrypt_bf_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv);
 	
@@ -297,12 +426,24 @@ public:
 	static data bf7_block_encrypt(data& a_block, data& a_key);
 	static data bf7_block_decrypt(data& a_block, data& a_key);
 	static data bf7_encrypt_with_cbc(data& a_data, data& a_key, data& a_iv);
-	static data bf7_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv);
+	static data bf7_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv, std::size_t a_threads = 1);
+	static void bf7_encrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv);
+	static void bf7_decrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv, std::size_t a_threads = 1);
+	static void bf7_encrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv);
+	static void bf7_decrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv, std::size_t a_threads = 1);
 	static data encrypt_bf7_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv);
 	static data decrypt_bf7_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv);
+	// the seven Blowfish key schedules for a Blowfish7 key, set up once
+	class bf7_context;
 	
 	static std::string encode_little_secret(const std::string& a_passphrase, const std::string& a_message);
 	static std::string decode_little_secret(const std::string& a_passphrase, const std::string& a_message);
+	// one result per message, in order, each exactly what decode_little_secret() would return
+	static std::vector<std::string> decode_little_secrets(const std::string& a_passphrase, const std::vector<std::string>& a_messages);
+	// the little secret functions keep ready Blowfish7 contexts for the most recently used passphrases, looked up
+	// by the passphrase's SHA-256. 0 entries turns the cache off and empties it.
+	static const std::size_t LITTLE_SECRET_CACHE_ENTRIES = 16;
+	static void little_secret_cache_size(std::size_t a_entries);
 
 	static data aes256_key_random();
 	static data aes256_key_schedule(const std::string& a_string);
@@ -311,32 +452,364 @@ public:
 	static data aes256_block_encrypt(data& a_block, data& a_key);
 	static data aes256_block_decrypt(data& a_block, data& a_key);
 	static data aes256_encrypt_with_cbc(data& a_data, data& a_key, data& a_iv);
-	static data aes256_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv);
+	static data aes256_decrypt_with_cbc(data& a_data, data& a_key, data& a_iv, std::size_t a_threads = 1);
+	static void aes256_encrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv);
+	static void aes256_decrypt_with_cbc_in_place(data& a_data, data& a_key, data& a_iv, std::size_t a_threads = 1);
+	static void aes256_encrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv);
+	static void aes256_decrypt_with_cbc(std::span<std::uint8_t> a_buf, data& a_key, data& a_iv, std::size_t a_threads = 1);
 	static data encrypt_aes256_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv);
 	static data decrypt_aes256_cbc_hmac_sha2_256(data& a_data, data& a_key, data& a_iv);
+	// counter mode: a_iv is the 16 byte initial counter block, and the same call encrypts and decrypts.
+	// Like CBC decryption, 4MB or more can be split across a_threads threads (0 for one per core).
+	static data aes256_ctr(data& a_data, data& a_key, data& a_iv, std::size_t a_threads = 1);
+	// GCM: 12 byte IV, output is the ciphertext followed by the 16 byte tag. a_aad is authenticated but not
+	// encrypted, and has to be passed again to decrypt. Never reuse an IV with the same key. Messages are
+	// limited to 2^36 - 32 bytes.
+	static data aes256_gcm_iv_random();
+	static data encrypt_aes256_gcm(data& a_data, data& a_key, data& a_iv, const data& a_aad = data(), std::size_t a_threads = 1);
+	static data decrypt_aes256_gcm(data& a_data, data& a_key, data& a_iv, const data& a_aad = data(), std::size_t a_threads = 1);
+	// an expanded AES256 key; keep one around to encrypt many blocks or messages with the same key
+	class aes256_context;
 	
 	/* compression */
 	
-	data huffman_encode() const;
+	// canonical mode writes code lengths instead of frequencies and decodes through a lookup table.
+	// huffman_decode reads either format.
+	data huffman_encode(bool a_canonical = true) const;
 	data huffman_decode() const;
 	void set_huffman_debug(bool a_debug) { m_huffman_debug = a_debug; };
 	data rle_encode() const;
 	data rle_decode() const;
-	data range_encode(std::function<void(std::uint64_t, std::uint64_t)> a_status_cb = default_predicate);
+	// LZSS dictionary coder: hash chain match finder with one byte lazy matching, optionally followed by one of
+	// the entropy coders above. lz_decode works out which from the header.
+	data lz_encode(lz_backend a_backend = LZ_HUFFMAN) const;
+	data lz_decode() const;
+	// RANGE_STATIC scales each segment's byte counts into fixed point cumulative frequencies and decodes through
+	// a lookup table. RANGE_ORDER1 keeps an adaptive table for each previous byte and ships no tables at all.
+	// RANGE_LONG_DOUBLE is the original format. range_decode reads any of them.
+	enum range_model { RANGE_LONG_DOUBLE = 0, RANGE_STATIC = 1, RANGE_ORDER1 = 2 };
+	data range_encode(std::function<void(std::uint64_t, std::uint64_t)> a_status_cb = default_predicate, range_model a_model = RANGE_STATIC);
 	data range_decode(std::function<void(std::uint64_t, std::uint64_t)> a_status_cb = default_predicate);
+
+	/* streaming compression */
+
+	// Streaming codecs take their input a chunk at a time, so neither the input nor the output has to be in
+	// memory in one piece. The RLE codecs read and write the same format as rle_encode/rle_decode; the range
+	// codecs use a framed variant of the integer coder format that only range_stream_decoder reads.
+	class stream_codec;
+	class rle_stream_encoder;
+	class rle_stream_decoder;
+	class range_stream_encoder;
+	class range_stream_decoder;
+	const static std::size_t STREAM_WINDOW = 1048576; // default amount of input to buffer at a time
+	// run a_in_filename through a_codec into a_out_filename, reading a_window bytes at a time
+	static void stream_file(const std::string& a_in_filename, const std::string& a_out_filename, stream_codec& a_codec, std::size_t a_window = STREAM_WINDOW);
 	
 protected:
+	data huffman_encode_canonical() const;
+	data huffman_decode_canonical() const;
+
+	friend class data_view;
 	bool m_network_byte_order;
 	bool m_circular_mode;
+	mutable std::size_t m_ring_head; // this and m_buffer are mutable so const methods can unwrap the ring
+	std::size_t m_ring_size;
 	std::size_t m_read_cursor;
 	std::size_t m_write_cursor;
 	bit_cursor m_read_bit_cursor;
 	bit_cursor m_write_bit_cursor;
-	std::vector<std::uint8_t> m_buffer;
+	mutable std::vector<std::uint8_t> m_buffer;
 	std::uint8_t m_delimiter;
 	bool m_huffman_debug;
 };
 
+// a_lhs, settings and cursors included, with a_rhs appended; an rvalue a_lhs is appended to rather than copied
+data operator+(const data& a_lhs, const data& a_rhs);
+data operator+(data&& a_lhs, const data& a_rhs);
+
+// The static bf7 functions above build one of these per call. Output is the same either way.
+// Encrypting goes through per-context scratch space, so don't share one context between threads.
+class data::bf7_context {
+public:
+	bf7_context(const data& a_key);
+	void encrypt_block(std::uint8_t *a_block); // 16 bytes in place
+	void decrypt_block(std::uint8_t *a_block);
+	data encrypt_cbc(const data& a_data, const data& a_iv);
+	data decrypt_cbc(const data& a_data, const data& a_iv, std::size_t a_threads = 1);
+	void encrypt_cbc_in_place(data& a_data, const data& a_iv);
+	void decrypt_cbc_in_place(data& a_data, const data& a_iv, std::size_t a_threads = 1);
+	void encrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv); // a whole number of blocks
+	void decrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv, std::size_t a_threads = 1);
+	data encrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv);
+	data decrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv);
+protected:
+	void encrypt_sub(std::size_t a_key, std::uint8_t *a_half); // one Blowfish pass with sub-key a_key on 8 bytes in place
+	void decrypt_sub(std::size_t a_key, std::uint8_t *a_half);
+	void cbc_encrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv); // a_len a multiple of 16, 16 byte a_iv
+	void cbc_decrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv);
+	std::array<std::uint8_t, 392> m_key; // kept for the HMAC
+	std::vector<ss::bf::block> m_bf;
+};
+
+// The static aes256 functions above build one of these per call. Output is the same either way.
+// Uses AES-NI when the CPU has it, unless a_hardware is false; otherwise the portable code in aes.c.
+class data::aes256_context {
+public:
+	aes256_context(const data& a_key, bool a_hardware = true);
+	bool hardware() const { return m_aesni; }
+	void encrypt_block(std::uint8_t *a_block) const { m_aesni ? AESNI_ECB_encrypt(&m_ni, a_block) : AES_ECB_encrypt(&m_ctx, a_block); } // 16 bytes in place
+	void decrypt_block(std::uint8_t *a_block) const { m_aesni ? AESNI_ECB_decrypt(&m_ni, a_block) : AES_ECB_decrypt(&m_ctx, a_block); }
+	data encrypt_cbc(const data& a_data, const data& a_iv) const;
+	data decrypt_cbc(const data& a_data, const data& a_iv, std::size_t a_threads = 1) const;
+	void encrypt_cbc_in_place(data& a_data, const data& a_iv) const;
+	void decrypt_cbc_in_place(data& a_data, const data& a_iv, std::size_t a_threads = 1) const;
+	void encrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv) const; // a whole number of blocks
+	void decrypt_cbc(std::span<std::uint8_t> a_buf, const data& a_iv, std::size_t a_threads = 1) const;
+	data encrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv) const;
+	data decrypt_cbc_hmac_sha2_256(const data& a_data, const data& a_iv) const;
+	data ctr(const data& a_data, const data& a_iv, std::size_t a_threads = 1) const;
+	data encrypt_gcm(const data& a_data, const data& a_iv, const data& a_aad = data(), std::size_t a_threads = 1) const;
+	data decrypt_gcm(const data& a_data, const data& a_iv, const data& a_aad = data(), std::size_t a_threads = 1) const;
+protected:
+	void cbc_encrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv) const; // a_len a multiple of 16, 16 byte a_iv
+	void cbc_decrypt(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_iv) const;
+	// xor the keystream from counter block a_ctr into a_buf; large buffers can be split across a_threads threads
+	void ctr_xor(std::uint8_t *a_buf, std::size_t a_len, const std::uint8_t *a_ctr, std::size_t a_threads) const;
+	void ghash(std::array<std::uint8_t, 16>& a_y, const std::uint8_t *a_buf, std::size_t a_len) const; // zero pads the last block
+	std::array<std::uint8_t, 16> gcm_tag(const std::uint8_t *a_iv, const data& a_aad, const std::uint8_t *a_ct, std::size_t a_len) const;
+	bool m_aesni;
+	std::array<std::uint8_t, 16> m_h; // GHASH key, the encryption of a zero block
+	struct AES_ctx m_ctx;
+	struct AESNI_ctx m_ni;
+	std::array<std::uint8_t, 32> m_key; // kept for the HMAC
+};
+
+// A file mapped into memory instead of copied onto the heap, so a large file can be hashed (hasher::update),
+// run through a stream codec or decrypted in place (the std::span cipher functions) a page at a time.
+// MAP_READ_ONLY maps an existing file. MAP_READ_WRITE opens the file, creating it if need be, sets its
+// length to a_size unless a_size is 0, and writes through writable() land in the file; sync() flushes them
+// now rather than whenever the kernel gets to it. Spans and views taken from a mapped_file die with it.
+class data::mapped_file {
+public:
+	enum map_mode { MAP_READ_ONLY, MAP_READ_WRITE };
+	mapped_file(const std::string& a_filename, map_mode a_mode = MAP_READ_ONLY, std::size_t a_size = 0);
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+	mapped_file(mapped_file&& a_mapped_file);
+	~mapped_file();
+	std::size_t size() const { return m_size; }
+	map_mode mode() const { return m_mode; }
+	std::span<const std::uint8_t> span() const { return std::span<const std::uint8_t>(m_map, m_size); }
+	std::span<std::uint8_t> writable(); // throws on a read only mapping
+	data_view view() const;
+	data to_data() const;
+	void sync();
+protected:
+	std::uint8_t *m_map;
+	std::size_t m_size;
+	map_mode m_mode;
+};
+
+// Same digests as md5(), sha1() and sha2_*() on the concatenation of everything passed to update().
+// finish() returns the digest and resets the hasher for another message of the same type.
+class data::hasher {
+public:
+	hasher(hash_type a_type);
+	void reset();
+	void update(const std::uint8_t *a_in, std::size_t a_len);
+	void update(const data& a_data) { update(a_data.contents().data(), a_data.size()); }
+	void update(const data& a_data, std::size_t a_offset, std::size_t a_len); // doesn't touch cursors
+	data finish();
+	hash_type type() const { return m_type; }
+	std::size_t digest_size() const;
+protected:
+	hash_type m_type;
+	MD5_CTX m_md5;
+	SHA1Context m_sha1;
+	sha256_ctx m_sha256; // SHA-224 too
+	sha512_ctx m_sha512; // SHA-384 too
+};
+
+// Same digests as hmacsha224(), hmacsha256(), hmacsha384() and hmacsha512() in hmac.c. The padded key blocks
+// are hashed once, by the constructor, and each message starts from those saved states. Copying a context
+// doesn't allocate, so keep one per key and copy it for each message or thread.
+// finish() returns the digest and resets the context for another message under the same key.
+class data::hmac_context {
+public:
+	hmac_context(const data& a_key, hash_type a_type = HASH_SHA2_256);
+	hmac_context(const std::uint8_t *a_key, std::size_t a_key_len, hash_type a_type = HASH_SHA2_256);
+	void reset();
+	void update(const std::uint8_t *a_in, std::size_t a_len);
+	void update(const data& a_data) { update(a_data.contents().data(), a_data.size()); }
+	data finish();
+	void finish(std::uint8_t *a_digest); // digest_size() bytes
+	data mac(const data& a_message) const; // one whole message, leaves this context as it was
+	hash_type type() const { return m_type; }
+	std::size_t digest_size() const;
+protected:
+	friend class data; // the batch functions start from the keyed states
+	enum { KEYED_INNER = 0, KEYED_OUTER = 1, MESSAGE = 2 };
+	void key(const std::uint8_t *a_key, std::size_t a_key_len);
+	hash_type m_type;
+	union {
+		sha256_ctx m_sha256[3]; // SHA-224 too
+		sha512_ctx m_sha512[3]; // SHA-384 too
+	};
+};
+
+// Push input in with push(), collect whatever output is ready with pull(). Call finish() after the last
+// chunk to flush the codec, then pull() the rest. A codec can't be reused after finish().
+class data::stream_codec {
+public:
+	stream_codec() { }
+	stream_codec(const stream_codec& a_codec) = delete;
+	virtual ~stream_codec() { }
+	virtual void push(const std::uint8_t *a_in, std::size_t a_len) = 0;
+	void push(const data& a_chunk) { push(a_chunk.contents().data(), a_chunk.size()); }
+	virtual void finish() = 0;
+	data pull(); // hands over all pending output
+	std::size_t pending() const { return m_out.size(); }
+protected:
+	std::vector<std::uint8_t> m_out;
+};
+
+class data::rle_stream_encoder : public data::stream_codec {
+public:
+	rle_stream_encoder();
+	using stream_codec::push;
+	virtual void push(const std::uint8_t *a_in, std::size_t a_len);
+	virtual void finish();
+protected:
+	void flush_run();
+	std::uint8_t m_escape;
+	std::uint8_t m_old;
+	std::uint8_t m_count;
+	bool m_clear; // m_old is empty
+};
+
+class data::rle_stream_decoder : public data::stream_codec {
+public:
+	rle_stream_decoder();
+	using stream_codec::push;
+	virtual void push(const std::uint8_t *a_in, std::size_t a_len);
+	virtual void finish() { }
+protected:
+	std::uint8_t m_escape;
+	enum { COLLECTING, FOUND_ESCAPE, FOUND_CHAR } m_state;
+	std::uint8_t m_repeat;
+};
+
+// RLE followed by the integer range coder. Input is held until a_window bytes of RLE output have built up,
+// then encoded as a batch of segments in parallel.
+class data::range_stream_encoder : public data::stream_codec {
+public:
+	range_stream_encoder(std::size_t a_window = STREAM_WINDOW);
+	using stream_codec::push;
+	virtual void push(const std::uint8_t *a_in, std::size_t a_len);
+	virtual void finish();
+protected:
+	void encode_segments(std::size_t a_len);
+	rle_stream_encoder m_rle;
+	std::vector<std::uint8_t> m_pending; // RLE output not yet range coded
+	std::size_t m_window;
+};
+
+// Decodes each batch of whole segments as soon as it has arrived; only a partial segment is ever held back.
+class data::range_stream_decoder : public data::stream_codec {
+public:
+	range_stream_decoder();
+	using stream_codec::push;
+	virtual void push(const std::uint8_t *a_in, std::size_t a_len);
+	virtual void finish();
+protected:
+	void decode_segments();
+	rle_stream_decoder m_rle;
+	data m_in; // input not yet decoded
+	bool m_have_cookie;
+	bool m_done; // end marker seen
+};
+
+// A read-only window on bytes that live somewhere else: part or all of a data object, or any memory that
+// outlives the view. It has its own read cursor, bit cursor, byte order and delimiter, and the same read
+// methods as data, but nothing is copied on the way: read_view() and read_string_view() return pieces of
+// the same memory. Views are cheap to copy and never own or free what they look at.
+class data_view {
+public:
+	data_view();
+	data_view(const std::uint8_t *a_buffer, std::size_t a_len);
+	data_view(std::span<const std::uint8_t> a_span) : data_view(a_span.data(), a_span.size()) { }
+	data_view(const data& a_data); // takes a_data's byte order and delimiter too
+
+	std::size_t size() const { return m_len; }
+	std::size_t remaining() const { return m_len - m_read_cursor; }
+	const std::uint8_t *buffer() const { return m_buffer; }
+	std::span<const std::uint8_t> span() const { return std::span<const std::uint8_t>(m_buffer, m_len); }
+	data_view subview(std::size_t a_offset, std::size_t a_len) const; // cursors start at the top
+	data to_data() const; // an owning copy
+
+	void set_read_cursor(std::size_t a_read_cursor);
+	std::size_t get_read_cursor() const { return m_read_cursor; }
+	void set_network_byte_order(bool a_setting) { m_network_byte_order = a_setting; }
+	bool get_network_byte_order() const { return m_network_byte_order; }
+	void set_delimiter(std::uint8_t a_delimiter) { m_delimiter = a_delimiter; }
+	std::uint8_t get_delimiter() const { return m_delimiter; }
+
+	/* bits */
+
+	void set_read_bit_cursor(data::bit_cursor a_bit_cursor);
+	data::bit_cursor get_read_bit_cursor() const { return m_read_bit_cursor; }
+	bool read_bit() { return read_bits(1) > 0; }
+	std::uint64_t read_bits(std::uint16_t a_count);
+
+	/* scalars */
+
+	std::uint8_t read_uint8();
+	std::int8_t read_int8() { return (std::int8_t)read_uint8(); }
+	std::uint16_t read_uint16() { return read_scalar<std::uint16_t>(); }
+	std::int16_t read_int16() { return read_scalar<std::int16_t>(); }
+	std::uint32_t read_uint32() { return read_scalar<std::uint32_t>(); }
+	std::int32_t read_int32() { return read_scalar<std::int32_t>(); }
+	std::uint64_t read_uint64() { return read_scalar<std::uint64_t>(); }
+	std::int64_t read_int64() { return read_scalar<std::int64_t>(); }
+	float read_float() { return std::bit_cast<float>(read_scalar<std::uint32_t>()); }
+	double read_double() { return std::bit_cast<double>(read_scalar<std::uint64_t>()); }
+	long double read_longdouble();
+	std::uint32_t read_uint24() { return (std::uint32_t)read_narrow(3, false); }
+	std::int32_t read_int24() { return (std::int32_t)read_narrow(3, true); }
+	std::uint64_t read_uint40() { return read_narrow(5, false); }
+	std::int64_t read_int40() { return (std::int64_t)read_narrow(5, true); }
+	std::uint64_t read_uint48() { return read_narrow(6, false); }
+	std::int64_t read_int48() { return (std::int64_t)read_narrow(6, true); }
+
+	/* strings and blocks */
+
+	data_view read_view(std::size_t a_len);
+	std::string_view read_string_view(std::size_t a_len);
+	std::optional<std::string_view> read_string_view_delim(); // up to the delimiter, which is skipped
+	std::string read_std_str(std::size_t a_len) { return std::string(read_string_view(a_len)); }
+	std::optional<std::string> read_std_str_delim();
+	std::string read_hex_str(std::size_t a_len);
+	std::string read_base64(std::size_t a_len);
+
+protected:
+	const std::uint8_t *take(std::size_t a_len); // a_len bytes at the read cursor, which moves past them
+	template <typename T> T read_scalar()
+	{
+		T l_ret;
+		memcpy(&l_ret, take(sizeof(T)), sizeof(T));
+		if ((std::endian::native == std::endian::little) && m_network_byte_order)
+			l_ret = std::byteswap(l_ret);
+		return l_ret;
+	}
+	std::uint64_t read_narrow(std::size_t a_num_bytes, bool a_signed);
+	const std::uint8_t *m_buffer;
+	std::size_t m_len;
+	std::size_t m_read_cursor;
+	data::bit_cursor m_read_bit_cursor;
+	bool m_network_byte_order;
+	std::uint8_t m_delimiter;
+};
+
 }; // namespace ss
 
 #endif // SS2XDATA_H
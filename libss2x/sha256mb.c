@@ -0,0 +1,265 @@
+/*
+
+Batched SHA-256. The SHA extensions path follows Intel's "Intel SHA Extensions" white paper (Gulley et al.),
+one message at a time; the AVX2 path is the multi-buffer scheme from Intel's "Fast Multi-buffer IPsec
+Implementations" paper, keeping eight independent messages in the eight 32 bit lanes and handing a lane the
+next message as soon as its current one is done. Both are compiled with target attributes, so the rest of the
+library doesn't need -mavx2 or -msha, and SHA256MB_best() picks one at run time. sha2.c is the fallback.
+
+*/
+
+#include <string.h>
+#include "sha2.h"
+#include "sha256mb.h"
+
+static void store_digest(const uint32_t h[8], uint8_t* digest)
+{
+	int i;
+	for (i = 0; i < 8; ++i) {
+		digest[i * 4] = h[i] >> 24;
+		digest[i * 4 + 1] = h[i] >> 16;
+		digest[i * 4 + 2] = h[i] >> 8;
+		digest[i * 4 + 3] = h[i];
+	}
+}
+
+// padding for the last partial block of a job: one or two blocks into tail, returns how many
+static size_t build_tail(const SHA256MB_job* job, uint8_t tail[128])
+{
+	size_t rem = job->len % 64;
+	size_t blocks = (rem + 9 > 64) ? 2 : 1;
+	uint64_t bits = (job->prefix_len + job->len) * 8;
+	int i;
+	memset(tail, 0, 128);
+	if (rem)
+		memcpy(tail, job->msg + job->len - rem, rem);
+	tail[rem] = 0x80;
+	for (i = 0; i < 8; ++i)
+		tail[blocks * 64 - 1 - i] = bits >> (i * 8);
+	return blocks;
+}
+
+static void run_scalar(SHA256MB_job* job)
+{
+	const size_t piece = 1 << 30; // sha256_update takes an unsigned int length
+	sha256_ctx ctx;
+	size_t pos;
+	memset(&ctx, 0, sizeof(ctx));
+	memcpy(ctx.h, job->h, sizeof(ctx.h));
+	ctx.tot_len = job->prefix_len;
+	for (pos = 0; pos < job->len; pos += piece)
+		sha256_update(&ctx, job->msg + pos, (job->len - pos < piece) ? job->len - pos : piece);
+	sha256_final(&ctx, job->digest);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define SHANI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static const uint32_t K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+int SHA256MB_best(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+		return SHA256MB_SHANI;
+	if (__builtin_cpu_supports("avx2"))
+		return SHA256MB_AVX2;
+	return SHA256MB_SCALAR;
+}
+
+static SHANI_TARGET void shani_blocks(uint32_t h[8], const uint8_t* data, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, tmp, msg, abef_save, cdgh_save;
+	__m128i w[4];
+	int i;
+
+	// the rounds instruction wants the state as ABEF and CDGH
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+	while (blocks--) {
+		abef_save = state0;
+		cdgh_save = state1;
+		for (i = 0; i < 4; ++i)
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), mask);
+		// sixteen groups of four rounds; w[i & 3] holds the schedule words for group i
+		for (i = 0; i < 16; ++i) {
+			if (i >= 4) {
+				tmp = _mm_add_epi32(_mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]), _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+				w[i & 3] = _mm_sha256msg2_epu32(tmp, w[(i + 3) & 3]);
+			}
+			msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i*)&K[i * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+			msg = _mm_shuffle_epi32(msg, 0x0e);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		}
+		state0 = _mm_add_epi32(state0, abef_save);
+		state1 = _mm_add_epi32(state1, cdgh_save);
+		data += 64;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	_mm_storeu_si128((__m128i*)&h[0], _mm_blend_epi16(tmp, state1, 0xf0));
+	_mm_storeu_si128((__m128i*)&h[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+static void run_shani(SHA256MB_job* job)
+{
+	uint32_t h[8];
+	uint8_t tail[128];
+	size_t tail_blocks = build_tail(job, tail);
+	memcpy(h, job->h, sizeof(h));
+	shani_blocks(h, job->msg, job->len / 64);
+	shani_blocks(h, tail, tail_blocks);
+	store_digest(h, job->digest);
+}
+
+#define ROTR8(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+// one block for each of eight states; st[word][lane], lane l's block is blk[l * 64]
+static AVX2_TARGET void avx2_compress(uint32_t st[8][8], const uint8_t* blk)
+{
+	const __m256i index = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112);
+	const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	__m256i a = _mm256_loadu_si256((const __m256i*)st[0]);
+	__m256i b = _mm256_loadu_si256((const __m256i*)st[1]);
+	__m256i c = _mm256_loadu_si256((const __m256i*)st[2]);
+	__m256i d = _mm256_loadu_si256((const __m256i*)st[3]);
+	__m256i e = _mm256_loadu_si256((const __m256i*)st[4]);
+	__m256i f = _mm256_loadu_si256((const __m256i*)st[5]);
+	__m256i g = _mm256_loadu_si256((const __m256i*)st[6]);
+	__m256i h = _mm256_loadu_si256((const __m256i*)st[7]);
+	__m256i w[16];
+	__m256i t1, t2, x, y;
+	int t;
+
+	for (t = 0; t < 64; ++t) {
+		if (t < 16) {
+			x = _mm256_i32gather_epi32((const int*)blk, _mm256_add_epi32(index, _mm256_set1_epi32(t)), 4);
+			w[t] = _mm256_shuffle_epi8(x, bswap);
+		} else {
+			x = w[(t + 1) & 15];
+			y = w[(t + 14) & 15];
+			x = _mm256_xor_si256(_mm256_xor_si256(ROTR8(x, 7), ROTR8(x, 18)), _mm256_srli_epi32(x, 3));
+			y = _mm256_xor_si256(_mm256_xor_si256(ROTR8(y, 17), ROTR8(y, 19)), _mm256_srli_epi32(y, 10));
+			w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], x), _mm256_add_epi32(w[(t + 9) & 15], y));
+		}
+		t1 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(e, 6), ROTR8(e, 11)), ROTR8(e, 25));
+		t1 = _mm256_add_epi32(_mm256_add_epi32(h, t1), _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)));
+		t1 = _mm256_add_epi32(_mm256_add_epi32(t1, _mm256_set1_epi32(K[t])), w[t & 15]);
+		t2 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(a, 2), ROTR8(a, 13)), ROTR8(a, 22));
+		t2 = _mm256_add_epi32(t2, _mm256_xor_si256(_mm256_and_si256(a, _mm256_xor_si256(b, c)), _mm256_and_si256(b, c)));
+		h = g;
+		g = f;
+		f = e;
+		e = _mm256_add_epi32(d, t1);
+		d = c;
+		c = b;
+		b = a;
+		a = _mm256_add_epi32(t1, t2);
+	}
+
+	_mm256_storeu_si256((__m256i*)st[0], _mm256_add_epi32(a, _mm256_loadu_si256((const __m256i*)st[0])));
+	_mm256_storeu_si256((__m256i*)st[1], _mm256_add_epi32(b, _mm256_loadu_si256((const __m256i*)st[1])));
+	_mm256_storeu_si256((__m256i*)st[2], _mm256_add_epi32(c, _mm256_loadu_si256((const __m256i*)st[2])));
+	_mm256_storeu_si256((__m256i*)st[3], _mm256_add_epi32(d, _mm256_loadu_si256((const __m256i*)st[3])));
+	_mm256_storeu_si256((__m256i*)st[4], _mm256_add_epi32(e, _mm256_loadu_si256((const __m256i*)st[4])));
+	_mm256_storeu_si256((__m256i*)st[5], _mm256_add_epi32(f, _mm256_loadu_si256((const __m256i*)st[5])));
+	_mm256_storeu_si256((__m256i*)st[6], _mm256_add_epi32(g, _mm256_loadu_si256((const __m256i*)st[6])));
+	_mm256_storeu_si256((__m256i*)st[7], _mm256_add_epi32(h, _mm256_loadu_si256((const __m256i*)st[7])));
+}
+
+static void run_avx2(SHA256MB_job* jobs, size_t count)
+{
+	uint32_t st[8][8];
+	uint8_t blk[8 * 64];
+	uint8_t tail[8][128];
+	SHA256MB_job* lane_job[8] = { 0 };
+	size_t lane_block[8], lane_full[8], lane_total[8];
+	uint32_t h[8];
+	size_t next = 0;
+	int lane, w, active;
+
+	memset(blk, 0, sizeof(blk));
+	for (;;) {
+		// refill idle lanes and gather this round's block for each busy one; idle lanes hash leftovers
+		active = 0;
+		for (lane = 0; lane < 8; ++lane) {
+			if ((!lane_job[lane]) && (next < count)) {
+				lane_job[lane] = &jobs[next++];
+				for (w = 0; w < 8; ++w)
+					st[w][lane] = lane_job[lane]->h[w];
+				lane_block[lane] = 0;
+				lane_full[lane] = lane_job[lane]->len / 64;
+				lane_total[lane] = lane_full[lane] + build_tail(lane_job[lane], tail[lane]);
+			}
+			if (!lane_job[lane])
+				continue;
+			++active;
+			if (lane_block[lane] < lane_full[lane])
+				memcpy(blk + lane * 64, lane_job[lane]->msg + lane_block[lane] * 64, 64);
+			else
+				memcpy(blk + lane * 64, tail[lane] + (lane_block[lane] - lane_full[lane]) * 64, 64);
+		}
+		if (!active)
+			break;
+		avx2_compress(st, blk);
+		for (lane = 0; lane < 8; ++lane) {
+			if ((!lane_job[lane]) || (++lane_block[lane] < lane_total[lane]))
+				continue;
+			for (w = 0; w < 8; ++w)
+				h[w] = st[w][lane];
+			store_digest(h, lane_job[lane]->digest);
+			lane_job[lane] = 0;
+		}
+	}
+}
+
+void SHA256MB_run(SHA256MB_job* jobs, size_t count, int backend)
+{
+	int best = SHA256MB_best();
+	size_t i;
+	if ((backend == SHA256MB_SHANI) && (best == SHA256MB_SHANI)) {
+		for (i = 0; i < count; ++i)
+			run_shani(&jobs[i]);
+	} else if ((backend == SHA256MB_AVX2) && (best != SHA256MB_SCALAR) && (__builtin_cpu_supports("avx2"))) {
+		run_avx2(jobs, count);
+	} else {
+		for (i = 0; i < count; ++i)
+			run_scalar(&jobs[i]);
+	}
+}
+
+#else
+
+int SHA256MB_best(void)
+{
+	return SHA256MB_SCALAR;
+}
+
+void SHA256MB_run(SHA256MB_job* jobs, size_t count, int backend)
+{
+	size_t i;
+	for (i = 0; i < count; ++i)
+		run_scalar(&jobs[i]);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SHA256MB_H
+#define SHA256MB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+// SHA-256 over many independent messages at once. SHA256MB_SHANI runs each message through the SHA
+// extensions, SHA256MB_AVX2 hashes eight messages side by side in the lanes of the AVX2 registers, and
+// SHA256MB_SCALAR goes through sha2.c. Asking for a backend the CPU doesn't have falls back to sha2.c.
+
+enum { SHA256MB_SCALAR = 0, SHA256MB_AVX2 = 1, SHA256MB_SHANI = 2 };
+
+// one message: hashing starts from state h after prefix_len bytes (sha256_init's state and 0 for a plain
+// hash, or a midstate and a multiple of 64, as HMAC uses) and continues over len bytes at msg.
+typedef struct
+{
+  uint32_t h[8];
+  uint64_t prefix_len;
+  const uint8_t* msg;
+  size_t len;
+  uint8_t* digest; // 32 bytes out
+} SHA256MB_job;
+
+int SHA256MB_best(void); // the fastest backend this CPU has
+void SHA256MB_run(SHA256MB_job* jobs, size_t count, int backend);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHA256MB_H */
@@ -198,7 +198,11 @@ int main(int argc, char **argv)
 	ctx.log(std::format("sha2_256: {}", c.sha2_256().as_hex_str_nospace()));
 	ctx.log(std::format("sha2_384: {}", c.sha2_384().as_hex_str_nospace()));
 	ctx.log(std::format("sha2_512: {}", c.sha2_512().as_hex_str_nospace()));
-	
+	ss::data::hasher l_hasher(ss::data::HASH_SHA2_256);
+	for (std::size_t i = 0; i < c.size(); i += 1000)
+		l_hasher.update(c, i, std::min<std::size_t>(1000, c.size() - i));
+	ctx.log(std::format("sha2_256 in 1000 byte pieces: {} hash_file: {}", l_hasher.finish().as_hex_str_nospace(), ss::data::hash_file("ss2x.cc", ss::data::HASH_SHA2_256).as_hex_str_nospace()));
+
 	ss::data b;
 	b.write_int8(-3);
 	ctx.log(std::format("write -3, read as uint8: {}", b.read_uint8()));
@@ -376,6 +380,16 @@ int main(int argc, char **argv)
 	ss::data htrep_decomp = htrep_comp.huffman_decode();
 	ctx.log(std::format("decoded 500 length repeating character file, len={} check {}", htrep_decomp.size(), (htrep_decomp == htrep)));
 
+	// the legacy frequency table format should still round trip
+	ss::data htrep_legacy_comp = htrep.huffman_encode(false);
+	ss::data htrep_legacy_decomp = htrep_legacy_comp.huffman_decode();
+	ctx.log(std::format("legacy format 500 length repeating character file, len={} check {}", htrep_legacy_comp.size(), (htrep_legacy_decomp == htrep)));
+
+	// LZ should collapse the repeating file to a handful of matches
+	ss::data htrep_lz_comp = htrep.lz_encode(ss::data::LZ_RAW);
+	ss::data htrep_lz_decomp = htrep_lz_comp.lz_decode();
+	ctx.log(std::format("lz 500 length repeating character file, len={} check {}", htrep_lz_comp.size(), (htrep_lz_decomp == htrep)));
+
 	// test RLE function
 	ss::data rle_man1;
 	rle_man1.write_hex_str("a1a2a3a4a5a5a5a5a5a5a5818283ffffffffffff0010");
@@ -384,6 +398,48 @@ int main(int argc, char **argv)
 	ctx.log(rle_man1.as_hex_str_nospace());
 	ctx.log(rle_man1_enc.as_hex_str_nospace());
 	ctx.log(rle_man1_dec.as_hex_str_nospace());
+
+	// streaming codecs, fed a few bytes at a time
+	ss::data stream_in;
+	for (std::size_t i = 0; i < 100000; ++i)
+		stream_in.write_uint8((i / 7) % 13);
+	ss::data::range_stream_encoder stream_enc;
+	ss::data stream_comp;
+	for (std::size_t i = 0; i < stream_in.size(); i += 777) {
+		stream_enc.push(&stream_in[i], std::min<std::size_t>(777, stream_in.size() - i));
+		stream_comp += stream_enc.pull();
+	}
+	stream_enc.finish();
+	stream_comp += stream_enc.pull();
+	ss::data::range_stream_decoder stream_dec;
+	ss::data stream_decomp;
+	for (std::size_t i = 0; i < stream_comp.size(); i += 333) {
+		stream_dec.push(&stream_comp[i], std::min<std::size_t>(333, stream_comp.size() - i));
+		stream_decomp += stream_dec.pull();
+	}
+	stream_dec.finish();
+	stream_decomp += stream_dec.pull();
+	ctx.log(std::format("range stream len {} comp len {} decomp len {} check {}", stream_in.size(), stream_comp.size(), stream_decomp.size(), (stream_decomp == stream_in)));
+	ss::data::rle_stream_encoder rle_stream;
+	rle_stream.push(stream_in);
+	rle_stream.finish();
+	ctx.log(std::format("rle stream matches rle_encode: {}", (rle_stream.pull() == stream_in.rle_encode())));
+	// a circular buffer pushes only its unread bytes
+	ss::data stream_circ;
+	stream_circ.set_circular_mode(true);
+	stream_circ.write_std_str("abcdefgh");
+	stream_circ.truncate_front(3);
+	stream_circ.write_std_str("XY");
+	ss::data::rle_stream_encoder rle_circ_enc;
+	rle_circ_enc.push(stream_circ);
+	rle_circ_enc.finish();
+	ss::data::rle_stream_decoder rle_circ_dec;
+	rle_circ_dec.push(rle_circ_enc.pull());
+	rle_circ_dec.finish();
+	ss::data stream_circ_out = rle_circ_dec.pull();
+	ss::data stream_circ_expect;
+	stream_circ_expect.write_std_str("defghXY");
+	ctx.log(std::format("rle stream of circular buffer len {} check {}", stream_circ_out.size(), (stream_circ_out == stream_circ_expect)));
 	
 	if (FILE_COMPRESS) {
 		for (const auto& l_file : std::filesystem::recursive_directory_iterator(".")) {
@@ -405,6 +461,11 @@ int main(int argc, char **argv)
 				ss::data ranger_comp = ranger.range_encode();
 				ss::data ranger_decomp = ranger_comp.range_decode();
 				ctx.log(std::format("{} ranger len: {} ranger_comp len: {} ranger_decomp len: {} ratio: {:.5}% check: {}", std::string(l_file.path()), ranger.size(), ranger_comp.size(), ranger_decomp.size(), ((float)ranger_comp.size() / (float)ranger.size()) * 100.0, (ranger_decomp == ranger)));
+				ss::data lz;
+				lz.load_file(l_file.path());
+				ss::data lz_comp = lz.lz_encode();
+				ss::data lz_decomp = lz_comp.lz_decode();
+				ctx.log(std::format("{} lz len: {} lz_comp len: {} lz_decomp len: {} ratio: {:.5}% check: {}", std::string(l_file.path()), lz.size(), lz_comp.size(), lz_decomp.size(), ((float)lz_comp.size() / (float)lz.size()) * 100.0, (lz_decomp == lz)));
 			}
 		}
 	}